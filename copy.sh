@@ -16,7 +16,8 @@ HEADERS_DIRS=(./include/base
               ./include/net 
               ./include/net/poller 
               ./include/net/timer 
-              ./include/pool/ThreadPool)  
+              ./include/pool/ThreadPool
+              ./include/pool/MemoryPool)  
   
 # 遍历每个目录，并复制其中的.h文件到目标目录  
 for dir in "${HEADERS_DIRS[@]}"; do  
@@ -0,0 +1,89 @@
+#include <TinyNetwork/Buffer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <x86intrin.h>
+
+/**
+ * 小包读取的微基准: 每轮向 socketpair 写入 msgSize 字节，再从另一端读出
+ *   old: 旧版 Buffer::readFd 的做法，每次在栈上开辟 64K extrabuf 并清零
+ *   new: 当前 Buffer::readFd，使用线程共享的溢出区 + 自适应预留
+ * 两者都包含 write/readv 两次系统调用，差值即每次读省下的周期数
+ */
+
+// 旧版 readFd 的读路径 (仅保留与栈上 extrabuf 相关的部分)
+static ssize_t oldReadFd(Buffer* buf, int fd)
+{
+    char extrabuf[65536] = {0};
+    struct iovec vec[2];
+    const size_t writable = buf->writableBytes();
+    vec[0].iov_base = buf->beginWrite();
+    vec[0].iov_len = writable;
+    vec[1].iov_base = extrabuf;
+    vec[1].iov_len = sizeof extrabuf;
+    const ssize_t n = ::readv(fd, vec, writable < sizeof extrabuf ? 2 : 1);
+    buf->retrieveAll();
+    return n;
+}
+
+static ssize_t newReadFd(Buffer* buf, int fd)
+{
+    int savedErrno = 0;
+    ssize_t n = buf->readFd(fd, &savedErrno);
+    buf->retrieveAll();
+    return n;
+}
+
+template <typename ReadFunc>
+static double run(ReadFunc readFunc, int sv[2], size_t msgSize, int iterations)
+{
+    char msg[4096];
+    memset(msg, 'x', sizeof msg);
+
+    Buffer buf;
+    buf.ensureWriteableBytes(Buffer::kInitialSize);
+
+    unsigned long long total = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        if (::write(sv[0], msg, msgSize) != static_cast<ssize_t>(msgSize))
+        {
+            perror("write");
+            exit(1);
+        }
+        unsigned long long start = __rdtsc();
+        readFunc(&buf, sv[1]);
+        total += __rdtsc() - start;
+    }
+    return static_cast<double>(total) / iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+
+    const size_t sizes[] = { 100, 512, 1000, 4000 };
+    printf("%10s %16s %16s %16s\n", "msg bytes", "old cycles/read", "new cycles/read", "saved");
+    for (size_t msgSize : sizes)
+    {
+        double oldCycles = run(oldReadFd, sv, msgSize, iterations);
+        double newCycles = run(newReadFd, sv, msgSize, iterations);
+        printf("%10zu %16.0f %16.0f %16.0f\n", msgSize, oldCycles, newCycles, oldCycles - newCycles);
+    }
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <TinyNetwork/TcpServer.h>
+#include <TinyNetwork/EventLoop.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 水平触发 / 边缘触发对比 (loopback echo，流水线负载)
+ * clients 个客户端线程，每轮连续写出 depth 个 msgSize 字节的请求，再读回全部回显，共 rounds 轮
+ * 服务端单个 loop，onMessage 把收到的数据原样发回
+ *
+ * 输出吞吐以及服务端 loop 的 epoll_wait 调用次数、返回的就绪事件数、epoll_ctl 调用次数
+ *
+ * 用法: bench_edge_triggered [lt|et] [clients] [rounds] [depth] [msgSize] [readBudget]
+ */
+
+static const uint16_t kPort = 9982;
+
+static void runClient(int rounds, int depth, int msgSize)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    std::string request(msgSize, 'p');
+    std::vector<char> buf(64 * 1024);
+    const size_t burst = static_cast<size_t>(depth) * msgSize;
+    for (int r = 0; r < rounds; ++r)
+    {
+        // 一轮内的请求逐个写出，不等回应
+        for (int i = 0; i < depth; ++i)
+        {
+            if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size()))
+            {
+                perror("write");
+                exit(1);
+            }
+        }
+
+        size_t received = 0;
+        while (received < burst)
+        {
+            ssize_t n = ::read(fd, buf.data(), buf.size());
+            if (n <= 0)
+            {
+                perror("read");
+                exit(1);
+            }
+            received += n;
+        }
+    }
+    ::close(fd);
+}
+
+int main(int argc, char* argv[])
+{
+    bool edgeTriggered = argc > 1 && strcmp(argv[1], "et") == 0;
+    int clients = argc > 2 ? atoi(argv[2]) : 8;
+    int rounds = argc > 3 ? atoi(argv[3]) : 2000;
+    int depth = argc > 4 ? atoi(argv[4]) : 32;
+    int msgSize = argc > 5 ? atoi(argv[5]) : 512;
+    size_t readBudget = argc > 6 ? atoi(argv[6]) : TcpConnection::kDefaultEdgeReadBudget;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(kPort), "bench_edge_triggered");
+    server.setEdgeTriggered(edgeTriggered, readBudget);
+    server.setConnectioncallback([](const TcpConnectionPtr&) {});
+    server.setMessagecallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+        conn->send(buf->retrieveAllAsString());
+    });
+    server.start();
+
+    std::atomic_bool done(false);
+    uint64_t polls = 0;
+    uint64_t events = 0;
+    uint64_t ctls = 0;
+    Timestamp start;
+    std::thread driver([&]() {
+        // 等 loop 跑起来再开始计数
+        usleep(100 * 1000);
+        polls = loop.pollCalls();
+        events = loop.pollEvents();
+        ctls = loop.pollerCtlCalls();
+        start = Timestamp::now1();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < clients; ++i)
+        {
+            threads.emplace_back(runClient, rounds, depth, msgSize);
+        }
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+        done = true;
+    });
+    loop.runEvery(0.05, [&]() { if (done) loop.quit(); });
+    loop.loop();
+    driver.join();
+
+    Timestamp end = Timestamp::now1();
+    double seconds = static_cast<double>(end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+    double requests = static_cast<double>(clients) * rounds * depth;
+    printf("%s clients=%d rounds=%d depth=%d msg=%dB  %.3fs  %.0f req/s  "
+           "epoll_wait=%llu events=%llu epoll_ctl=%llu\n",
+           edgeTriggered ? "et" : "lt", clients, rounds, depth, msgSize, seconds, requests / seconds,
+           static_cast<unsigned long long>(loop.pollCalls() - polls),
+           static_cast<unsigned long long>(loop.pollEvents() - events),
+           static_cast<unsigned long long>(loop.pollerCtlCalls() - ctls));
+    fflush(stdout);
+
+    // 日志线程是分离的常驻线程，正常析构静态对象时会卡住，基准程序直接退出
+    _exit(0);
+}
@@ -0,0 +1,459 @@
+#include <TinyNetwork/EventLoop.h>
+#include <TinyNetwork/Channel.h>
+#include <TinyNetwork/TcpServer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Poller 后端的一致性检查与性能对比
+ *
+ * 后端由 Poller::newDefaultPoller 按环境变量选择，本程序在创建每个 EventLoop 之前设置环境变量，
+ * 让同一组场景依次跑在每个后端上:
+ *   epoll    默认的 EPollPoller
+ *   poll     MUDUO_USE_POLL    PollPoller
+ *   uring    MUDUO_USE_URING   IoUringPoller (内核不支持时退回 epoll，并打印错误日志)
+ *
+ * 一致性场景 (每个都在新的 EventLoop 中运行，输出 PASS / FAIL，后端不适用的输出 SKIP):
+ *   level      数据没读完时下一轮继续通知
+ *   write      enableWriting 后得到可写通知，disableWriting 后不再通知
+ *   remove     disableAll + remove 之后不再有任何回调
+ *   reuse      fd 关闭后被新的 channel 复用，事件只送达新的 channel
+ *   edge       边缘触发只在新数据到达时通知一次 (poll 没有边缘触发，SKIP)
+ *   etconn     边缘触发的 TcpConnection 空闲时 loop 不空转 (poll 后端应当退回水平触发)
+ *   wakeup     其他线程 queueInLoop 能唤醒阻塞中的 loop
+ *   timer      runAfter 按时触发
+ *
+ * 性能场景: 单个 loop 中注册 fds 个 socketpair 的读端，tokens 个令牌在其中接力 hops 次，
+ * 每次接力是一次就绪通知 + 一次 read + 一次 write；令牌越少，就绪的 fd 占比越低，越能体现 O(活跃数) 与 O(总数) 的差别
+ *
+ * 用法: bench_poller [backend,backend,...] [fds,fds,...] [tokens] [hops]
+ *   默认: bench_poller epoll,poll,uring 10,1000,50000 1 100000
+ */
+
+static void selectBackend(const std::string& backend)
+{
+    ::unsetenv("MUDUO_USE_POLL");
+    ::unsetenv("MUDUO_USE_URING");
+    if (backend == "poll")
+    {
+        ::setenv("MUDUO_USE_POLL", "1", 1);
+    }
+    else if (backend == "uring")
+    {
+        ::setenv("MUDUO_USE_URING", "1", 1);
+    }
+}
+
+static std::vector<std::string> split(const std::string& s)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= s.size())
+    {
+        size_t comma = s.find(',', start);
+        if (comma == std::string::npos)
+        {
+            comma = s.size();
+        }
+        if (comma > start)
+        {
+            parts.push_back(s.substr(start, comma - start));
+        }
+        start = comma + 1;
+    }
+    return parts;
+}
+
+// 一对非阻塞的 socketpair，loop 监听 fds[0]，测试从 fds[1] 写入
+struct Pair
+{
+    int fds[2];
+
+    Pair()
+    {
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+        {
+            perror("socketpair");
+            exit(1);
+        }
+    }
+
+    ~Pair()
+    {
+        close();
+    }
+
+    void close()
+    {
+        if (fds[0] >= 0)
+        {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            fds[0] = fds[1] = -1;
+        }
+    }
+
+    void send(const char* data)
+    {
+        ::write(fds[1], data, strlen(data));
+    }
+
+    bool readOne()
+    {
+        char c;
+        return ::read(fds[0], &c, 1) == 1;
+    }
+};
+
+// 在 seconds 秒后退出 loop
+static void runFor(EventLoop* loop, double seconds)
+{
+    loop->runAfter(seconds, [loop]() { loop->quit(); });
+    loop->loop();
+}
+
+// ---------------- 一致性场景 ----------------
+
+static bool checkLevel(const std::string&)
+{
+    EventLoop loop;
+    Pair pair;
+    Channel channel(&loop, pair.fds[0]);
+    int calls = 0;
+    channel.setReadCallback([&](Timestamp) {
+        // 每次只读一个字节，剩下的应当在后续轮次中继续通知
+        pair.readOne();
+        ++calls;
+    });
+    channel.enableReading();
+    pair.send("abc");
+    runFor(&loop, 0.05);
+    channel.disableAll();
+    channel.remove();
+    return calls == 3;
+}
+
+static bool checkWrite(const std::string&)
+{
+    EventLoop loop;
+    Pair pair;
+    Channel channel(&loop, pair.fds[0]);
+    int calls = 0;
+    channel.setWriteCallback([&]() {
+        ++calls;
+        channel.disableWriting();
+    });
+    channel.enableReading();
+    channel.enableWriting();
+    runFor(&loop, 0.05);
+    channel.disableAll();
+    channel.remove();
+    return calls == 1;
+}
+
+static bool checkRemove(const std::string&)
+{
+    EventLoop loop;
+    Pair pair;
+    Channel channel(&loop, pair.fds[0]);
+    int calls = 0;
+    channel.setReadCallback([&](Timestamp) { ++calls; });
+    channel.enableReading();
+    channel.disableAll();
+    channel.remove();
+    pair.send("x");
+    runFor(&loop, 0.05);
+    return calls == 0;
+}
+
+static bool checkReuse(const std::string&)
+{
+    EventLoop loop;
+    std::unique_ptr<Pair> oldPair(new Pair);
+    int oldCalls = 0;
+    int newCalls = 0;
+    {
+        Channel oldChannel(&loop, oldPair->fds[0]);
+        oldChannel.setReadCallback([&](Timestamp) { ++oldCalls; });
+        oldChannel.enableReading();
+        oldPair->send("x");
+        oldChannel.disableAll();
+        oldChannel.remove();
+    }
+    oldPair.reset();
+
+    // 新建的 socketpair 通常会拿到刚释放的 fd
+    Pair pair;
+    Channel channel(&loop, pair.fds[0]);
+    channel.setReadCallback([&](Timestamp) {
+        while (pair.readOne())
+        {
+        }
+        ++newCalls;
+    });
+    channel.enableReading();
+    pair.send("y");
+    runFor(&loop, 0.05);
+    channel.disableAll();
+    channel.remove();
+    return oldCalls == 0 && newCalls == 1;
+}
+
+static bool checkEdge(const std::string&)
+{
+    EventLoop loop;
+    Pair pair;
+    Channel channel(&loop, pair.fds[0]);
+    int calls = 0;
+    channel.setReadCallback([&](Timestamp) {
+        // 故意不读完，边缘触发不会再通知
+        pair.readOne();
+        ++calls;
+    });
+    channel.setEdgeTriggered(true);
+    channel.enableReading();
+    pair.send("abc");
+    runFor(&loop, 0.05);
+    int firstEdge = calls;
+
+    // 新数据到达是新的边缘
+    pair.send("d");
+    runFor(&loop, 0.05);
+    channel.disableAll();
+    channel.remove();
+    return firstEdge == 1 && calls == 2;
+}
+
+static bool checkEdgeConnection(const std::string&)
+{
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(19981), "etconn", TcpServer::kReusePost);
+    server.setEdgeTriggered(true);
+    int connected = 0;
+    server.setConnectioncallback([&](const TcpConnectionPtr& conn) {
+        if (conn->connected())
+        {
+            ++connected;
+        }
+    });
+    server.start();
+
+    // 一个建立连接后什么也不发的客户端
+    int client = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(19981);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::connect(client, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr);
+
+    // 连接空闲期间 loop 应当阻塞，而不是被常驻的写事件反复唤醒
+    uint64_t polls = loop.pollCalls();
+    runFor(&loop, 0.2);
+    polls = loop.pollCalls() - polls;
+    ::close(client);
+    return connected == 1 && polls < 100;
+}
+
+static bool checkWakeup(const std::string&)
+{
+    EventLoop loop;
+    std::atomic_bool ran(false);
+    std::thread other([&]() {
+        usleep(20 * 1000);
+        loop.queueInLoop([&]() {
+            ran = true;
+            loop.quit();
+        });
+    });
+    // 超时保护，正常情况下 quit 由投递的任务完成
+    loop.runAfter(2.0, [&]() { loop.quit(); });
+    Timestamp start = Timestamp::now1();
+    loop.loop();
+    Timestamp end = Timestamp::now1();
+    other.join();
+    return ran && end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch() < 1000 * 1000;
+}
+
+static bool checkTimer(const std::string&)
+{
+    EventLoop loop;
+    int fired = 0;
+    loop.runAfter(0.01, [&]() { ++fired; });
+    runFor(&loop, 0.05);
+    return fired == 1;
+}
+
+// ---------------- 性能场景 ----------------
+
+struct Ring
+{
+    EventLoop* loop;
+    std::vector<int> readFds;
+    std::vector<int> writeFds;
+    long long hops;
+    long long target;
+
+    void onReadable(size_t i)
+    {
+        char token;
+        if (::read(readFds[i], &token, 1) != 1)
+        {
+            return;
+        }
+        if (++hops >= target)
+        {
+            loop->quit();
+            return;
+        }
+        size_t next = (i + 1) % writeFds.size();
+        if (::write(writeFds[next], &token, 1) != 1)
+        {
+            perror("write");
+        }
+    }
+};
+
+static void runRing(const std::string& backend, int fds, int tokens, long long hops)
+{
+    // 每对占两个 fd，只在不够时提高上限 (提高硬上限需要特权)
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    rlim_t need = static_cast<rlim_t>(fds) * 2 + 64;
+    if (rl.rlim_cur < need)
+    {
+        rl.rlim_cur = need;
+        rl.rlim_max = std::max(rl.rlim_max, need);
+        if (::setrlimit(RLIMIT_NOFILE, &rl) < 0)
+        {
+            printf("%-6s fds=%-6d skipped: cannot raise RLIMIT_NOFILE to %llu\n",
+                   backend.c_str(), fds, static_cast<unsigned long long>(need));
+            fflush(stdout);
+            return;
+        }
+    }
+
+    EventLoop loop;
+    Ring ring;
+    ring.loop = &loop;
+    ring.hops = 0;
+    ring.target = hops;
+    std::vector<std::unique_ptr<Channel>> channels;
+    for (int i = 0; i < fds; ++i)
+    {
+        int sv[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0)
+        {
+            perror("socketpair");
+            exit(1);
+        }
+        ring.readFds.push_back(sv[0]);
+        ring.writeFds.push_back(sv[1]);
+
+        Channel* channel = new Channel(&loop, sv[0]);
+        channel->setReadCallback(std::bind(&Ring::onReadable, &ring, static_cast<size_t>(i)));
+        channel->enableReading();
+        channels.emplace_back(channel);
+    }
+
+    // 令牌均匀地放进环中
+    for (int i = 0; i < tokens; ++i)
+    {
+        char token = 't';
+        ::write(ring.writeFds[static_cast<size_t>(i) * fds / tokens], &token, 1);
+    }
+
+    uint64_t polls = loop.pollCalls();
+    uint64_t events = loop.pollEvents();
+    uint64_t ctls = loop.pollerCtlCalls();
+    Timestamp start = Timestamp::now1();
+    loop.loop();
+    Timestamp end = Timestamp::now1();
+
+    double seconds = static_cast<double>(end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+    printf("%-6s fds=%-6d tokens=%-4d hops=%lld  %.3fs  %.0f hops/s  %.2f us/hop  polls=%llu events=%llu ctl=%llu\n",
+           backend.c_str(), fds, tokens, ring.hops, seconds, ring.hops / seconds, seconds * 1e6 / ring.hops,
+           static_cast<unsigned long long>(loop.pollCalls() - polls),
+           static_cast<unsigned long long>(loop.pollEvents() - events),
+           static_cast<unsigned long long>(loop.pollerCtlCalls() - ctls));
+    fflush(stdout);
+
+    for (size_t i = 0; i < channels.size(); ++i)
+    {
+        channels[i]->disableAll();
+        channels[i]->remove();
+        ::close(ring.readFds[i]);
+        ::close(ring.writeFds[i]);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> backends = split(argc > 1 ? argv[1] : "epoll,poll,uring");
+    std::vector<std::string> fdCounts = split(argc > 2 ? argv[2] : "10,1000,50000");
+    int tokens = argc > 3 ? atoi(argv[3]) : 1;
+    long long hops = argc > 4 ? atoll(argv[4]) : 100000;
+
+    struct Check
+    {
+        const char* name;
+        bool (*run)(const std::string&);
+        const char* skipOn;             // 不适用的后端，输出 SKIP
+    };
+    const Check checks[] = {
+        { "level", checkLevel, "" },
+        { "write", checkWrite, "" },
+        { "remove", checkRemove, "" },
+        { "reuse", checkReuse, "" },
+        { "edge", checkEdge, "poll" },
+        { "etconn", checkEdgeConnection, "" },
+        { "wakeup", checkWakeup, "" },
+        { "timer", checkTimer, "" },
+    };
+
+    int failures = 0;
+    for (const std::string& backend : backends)
+    {
+        selectBackend(backend);
+        std::string line;
+        for (const Check& check : checks)
+        {
+            if (backend == check.skipOn)
+            {
+                line += std::string(" ") + check.name + "=SKIP";
+                continue;
+            }
+            bool ok = check.run(backend);
+            failures += ok ? 0 : 1;
+            line += std::string(" ") + check.name + (ok ? "=PASS" : "=FAIL");
+        }
+        printf("%-6s%s\n", backend.c_str(), line.c_str());
+        fflush(stdout);
+    }
+
+    for (const std::string& fds : fdCounts)
+    {
+        for (const std::string& backend : backends)
+        {
+            selectBackend(backend);
+            runRing(backend, atoi(fds.c_str()), tokens, hops);
+        }
+    }
+
+    // 日志线程是分离的常驻线程，正常析构静态对象时会卡住，基准程序直接退出
+    _exit(failures == 0 ? 0 : 1);
+}
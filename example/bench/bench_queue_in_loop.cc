@@ -0,0 +1,92 @@
+#include <TinyNetwork/EventLoop.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * 跨线程投递任务的吞吐: producers 个线程各自向同一个 EventLoop queueInLoop 投递 tasksPerProducer 个任务，
+ * 任务只在 loop 线程里给计数器加一，统计从开始投递到全部执行完毕的 tasks/sec
+ *
+ * 同时输出本轮实际写 eventfd 的唤醒次数和被合并掉的唤醒次数；busyPollMicros > 0 时 loop 开启忙轮询
+ *
+ * 用法: bench_queue_in_loop [tasksPerProducer] [maxProducers] [busyPollMicros]
+ */
+
+static long long g_executed = 0;                // 只在 loop 线程中修改
+
+static void runRound(EventLoop* loop, int producers, int tasksPerProducer)
+{
+    const long long total = static_cast<long long>(producers) * tasksPerProducer;
+    std::atomic_bool finished(false);
+
+    loop->runInLoop([]() { g_executed = 0; });
+    uint64_t issued = loop->wakeupsIssued();
+    uint64_t suppressed = loop->wakeupsSuppressed();
+
+    Timestamp start = Timestamp::now1();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([loop, tasksPerProducer, total, &finished]() {
+            for (int j = 0; j < tasksPerProducer; ++j)
+            {
+                loop->queueInLoop([total, &finished]() {
+                    if (++g_executed == total)
+                    {
+                        finished = true;
+                    }
+                });
+            }
+        });
+    }
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    while (!finished)
+    {
+        usleep(100);
+    }
+    Timestamp end = Timestamp::now1();
+
+    double seconds = static_cast<double>(end.microSecondsSinceEpoch() - start.microSecondsSinceEpoch()) / 1e6;
+    printf("producers=%2d  tasks=%lld  %.3fs  %.2f M tasks/sec  wakeups issued=%llu suppressed=%llu\n",
+           producers, total, seconds, total / seconds / 1e6,
+           static_cast<unsigned long long>(loop->wakeupsIssued() - issued),
+           static_cast<unsigned long long>(loop->wakeupsSuppressed() - suppressed));
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[])
+{
+    int tasksPerProducer = argc > 1 ? atoi(argv[1]) : 200000;
+    int maxProducers = argc > 2 ? atoi(argv[2]) : 32;
+    int64_t busyPollMicros = argc > 3 ? atoll(argv[3]) : 0;
+
+    EventLoop* loop = nullptr;
+    std::atomic_bool ready(false);
+    std::thread loopThread([&loop, &ready, busyPollMicros]() {
+        EventLoop ioLoop;
+        ioLoop.setBusyPollMicros(busyPollMicros);
+        loop = &ioLoop;
+        ready = true;
+        ioLoop.loop();
+    });
+    while (!ready)
+    {
+        usleep(1000);
+    }
+
+    for (int producers = 1; producers <= maxProducers; producers *= 2)
+    {
+        runRound(loop, producers, tasksPerProducer);
+    }
+
+    // 日志线程是分离的常驻线程，正常析构静态对象时会卡住，基准程序直接退出
+    _exit(0);
+}
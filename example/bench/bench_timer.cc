@@ -0,0 +1,174 @@
+#include <TinyNetwork/EventLoop.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * 定时器存储结构对比: 红黑树 (tree) / 分层时间轮 (wheel)
+ * 在 loop 线程中插入 timers 个一次性定时器，到期时间均匀分布在 [2s, 2s + spread] 内 (前 2s 留给插入 / 推迟 / 取消)，
+ * 每个定时器再通过 TimerId::reset 推迟 refreshes 次 (模拟每个请求刷新一次空闲超时)，取消其中 1/4，然后运行 loop 直到全部触发
+ *
+ * 输出插入、推迟、取消每次操作的耗时，到期处理阶段每个定时器消耗的 CPU 时间，以及触发的延迟 (实际触发时刻 - 最终到期时刻)
+ * 任何定时器提前触发、被取消的定时器触发、或者没有触发都会报告 FAIL
+ * 名字加上 -nofd 后缀 (如 wheel-nofd) 表示不使用 timerfd，定时器并入 poll 的超时
+ *
+ * 用法: bench_timer [tree,wheel,tree-nofd,wheel-nofd] [timers] [spreadSeconds] [refreshes]
+ */
+
+struct Stats
+{
+    EventLoop *loop;
+    std::vector<int64_t> deadlines;     // 每个定时器最终的到期时刻 (微秒)
+    std::vector<bool> canceled;
+    int expected;
+    int fired;
+    int early;
+    int firedCanceled;
+    int64_t latenessSum;
+    int64_t latenessMax;
+};
+
+static int64_t nowMicros()
+{
+    return Timestamp::now1().microSecondsSinceEpoch();
+}
+
+static int64_t cpuMicros()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000LL
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void onTimer(Stats *s, int index)
+{
+    if (s->canceled[index])
+    {
+        ++s->firedCanceled;
+    }
+    int64_t lateness = nowMicros() - s->deadlines[index];
+    if (lateness < 0)
+    {
+        ++s->early;
+    }
+    else
+    {
+        s->latenessSum += lateness;
+        if (lateness > s->latenessMax) s->latenessMax = lateness;
+    }
+    if (++s->fired == s->expected)
+    {
+        s->loop->quit();
+    }
+}
+
+static bool runEngine(const std::string& name, int timers, double spread, int refreshes)
+{
+    EventLoop loop;
+    loop.setTimerEngine(name.compare(0, 5, "wheel") == 0 ? TimerQueue::kTimerWheel : TimerQueue::kTimerTree);
+    loop.setUseTimerfd(name.find("-nofd") == std::string::npos);
+
+    Stats stats;
+    stats.loop = &loop;
+    stats.deadlines.resize(timers);
+    stats.canceled.assign(timers, false);
+    stats.expected = timers - (timers + 3) / 4;
+    stats.fired = 0;
+    stats.early = 0;
+    stats.firedCanceled = 0;
+    stats.latenessSum = 0;
+    stats.latenessMax = 0;
+
+    // 预先生成到期时间，计时只包含定时器本身的开销
+    int64_t spreadMicros = static_cast<int64_t>(spread * 1000000);
+    srand(12345);
+    for (int i = 0; i < timers; ++i)
+    {
+        stats.deadlines[i] = 2000000 + static_cast<int64_t>(spreadMicros * (static_cast<double>(rand()) / RAND_MAX));
+    }
+    std::vector<TimerId> ids(timers);
+
+    int64_t start = nowMicros();
+    for (int i = 0; i < timers; ++i)
+    {
+        stats.deadlines[i] += start;
+        Stats *s = &stats;
+        ids[i] = loop.runAt(Timestamp(stats.deadlines[i]), [s, i]() { onTimer(s, i); });
+    }
+    int64_t addMicros = nowMicros() - start;
+
+    // 每次推迟 1ms，最终比原来晚 refreshes 毫秒
+    start = nowMicros();
+    for (int r = 1; r <= refreshes; ++r)
+    {
+        for (int i = 0; i < timers; ++i)
+        {
+            stats.deadlines[i] += 1000;
+            ids[i].reset(Timestamp(stats.deadlines[i]));
+        }
+    }
+    int64_t refreshMicros = nowMicros() - start;
+
+    start = nowMicros();
+    for (int i = 0; i < timers; i += 4)
+    {
+        ids[i].cancel();
+        stats.canceled[i] = true;
+    }
+    int64_t cancelMicros = nowMicros() - start;
+
+    int64_t cpuStart = cpuMicros();
+    loop.loop();
+    int64_t cpuUsed = cpuMicros() - cpuStart;
+
+    bool ok = stats.fired == stats.expected && stats.early == 0 && stats.firedCanceled == 0;
+    printf("%-10s timers=%d spread=%.1fs  add %.0f ns  reset %.0f ns  cancel %.0f ns  "
+           "expire %.0f ns/timer (cpu)  lateness avg %.0f us max %lld us  %s\n",
+           name.c_str(), timers, spread,
+           addMicros * 1000.0 / timers,
+           refreshes > 0 ? refreshMicros * 1000.0 / (static_cast<double>(timers) * refreshes) : 0.0,
+           cancelMicros * 1000.0 / ((timers + 3) / 4),
+           cpuUsed * 1000.0 / stats.expected,
+           stats.fired > 0 ? static_cast<double>(stats.latenessSum) / stats.fired : 0.0,
+           static_cast<long long>(stats.latenessMax),
+           ok ? "PASS" : "FAIL");
+    if (!ok)
+    {
+        printf("       fired=%d expected=%d early=%d canceledFired=%d\n",
+               stats.fired, stats.expected, stats.early, stats.firedCanceled);
+    }
+    fflush(stdout);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string engines = argc > 1 ? argv[1] : "tree,wheel,tree-nofd,wheel-nofd";
+    int timers = argc > 2 ? atoi(argv[2]) : 200000;
+    double spread = argc > 3 ? atof(argv[3]) : 2.0;
+    int refreshes = argc > 4 ? atoi(argv[4]) : 10;
+
+    bool ok = true;
+    size_t pos = 0;
+    while (pos <= engines.size())
+    {
+        size_t comma = engines.find(',', pos);
+        if (comma == std::string::npos) comma = engines.size();
+        std::string name = engines.substr(pos, comma - pos);
+        if (!name.empty())
+        {
+            ok = runEngine(name, timers, spread, refreshes) && ok;
+        }
+        pos = comma + 1;
+    }
+
+    // 日志线程是分离的常驻线程，正常析构静态对象时会卡住，基准程序直接退出
+    _exit(ok ? 0 : 1);
+}
@@ -35,6 +35,13 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
         resp->setContentType("image/png");
         resp->setBody(std::string(favicon, sizeof favicon));
     }
+    else if (req.path() == "/source" && resp->setBodyFile("testhttpserver.cc"))
+    {
+        // 静态文件通过 sendfile 发送
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+    }
     else if (req.path() == "/hello")
     {
         resp->setStatusCode(HttpResponse::k200Ok);
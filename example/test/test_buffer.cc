@@ -0,0 +1,178 @@
+#include <TinyNetwork/Buffer.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <string>
+
+/**
+ * Buffer 的回归测试，任何一项失败时以非 0 退出
+ * 建议加上 -fsanitize=address 编译，越界写会被直接报告
+ *
+ * 用法: test_buffer
+ */
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        if (!(cond))                                                    \
+        {                                                               \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            ++g_failures;                                               \
+        }                                                               \
+    } while (0)
+
+// 按 1 字节循环填充的测试数据
+static std::string pattern(size_t len, char seed)
+{
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = static_cast<char>(seed + i % 26);
+    }
+    return s;
+}
+
+static void testTypedRoundTrip()
+{
+    Buffer buf;
+    buf.appendInt8(-8);
+    buf.appendInt16(-1616);
+    buf.appendInt32(-32323232);
+    buf.appendInt64(-6464646464646464LL);
+    buf.appendInt8(127);
+    buf.appendInt16(INT16_MIN);
+    buf.appendInt32(INT32_MAX);
+    buf.appendInt64(INT64_MIN);
+    CHECK(buf.readableBytes() == 2 * (1 + 2 + 4 + 8));
+
+    // peek 不移动读位置
+    CHECK(buf.peekInt8() == -8);
+    CHECK(buf.peekInt8() == -8);
+
+    CHECK(buf.readInt8() == -8);
+    CHECK(buf.peekInt16() == -1616);
+    CHECK(buf.readInt16() == -1616);
+    CHECK(buf.peekInt32() == -32323232);
+    CHECK(buf.readInt32() == -32323232);
+    CHECK(buf.peekInt64() == -6464646464646464LL);
+    CHECK(buf.readInt64() == -6464646464646464LL);
+    CHECK(buf.readInt8() == 127);
+    CHECK(buf.readInt16() == INT16_MIN);
+    CHECK(buf.readInt32() == INT32_MAX);
+    CHECK(buf.readInt64() == INT64_MIN);
+    CHECK(buf.readableBytes() == 0);
+}
+
+static void testNetworkByteOrder()
+{
+    Buffer buf;
+    buf.appendInt32(0x01020304);
+    CHECK(buf.readableBytes() == 4);
+    const char* p = buf.peek();
+    CHECK(p[0] == 1 && p[1] == 2 && p[2] == 3 && p[3] == 4);
+}
+
+static void testPrependTyped()
+{
+    Buffer buf;
+    std::string body = pattern(100, 'a');
+    buf.append(body.data(), body.size());
+    buf.prependInt32(static_cast<int32_t>(body.size()));
+    buf.prependInt16(7);
+    buf.prependInt8(-1);
+    buf.prependInt64(42);
+
+    CHECK(buf.readInt64() == 42);
+    CHECK(buf.readInt8() == -1);
+    CHECK(buf.readInt16() == 7);
+    CHECK(buf.readInt32() == 100);
+    CHECK(buf.retrieveAllAsString() == body);
+}
+
+// 先 prepend 用掉预置区，再 append 超过容量: 必须重新分配，而不是在原有空间里搬移
+static void testPrependThenAppendPastCapacity()
+{
+    Buffer buf;
+    std::string first = pattern(Buffer::kInitialSize, 'a');
+    buf.append(first.data(), first.size());
+    buf.prependInt32(42);
+    CHECK(buf.prependableBytes() < Buffer::kCheapPrepend);
+
+    std::string second = pattern(100, 'A');
+    buf.append(second.data(), second.size());
+    CHECK(buf.writableBytes() <= buf.internalCapacity());
+
+    CHECK(buf.readInt32() == 42);
+    CHECK(buf.retrieveAsString(first.size()) == first);
+    CHECK(buf.retrieveAllAsString() == second);
+}
+
+// prepend 超过预置区，数据整体后移
+static void testPrependLargerThanPrependable()
+{
+    Buffer buf;
+    std::string body = pattern(50, 'k');
+    buf.append(body.data(), body.size());
+    std::string header = pattern(Buffer::kCheapPrepend * 4, 'H');
+    buf.prepend(header.data(), header.size());
+    CHECK(buf.retrieveAllAsString() == header + body);
+}
+
+// 读走一部分后再写入，空间足够时把剩余数据搬回头部，而不是重新分配
+static void testCompaction()
+{
+    Buffer buf;
+    std::string first = pattern(Buffer::kInitialSize, 'a');
+    buf.append(first.data(), first.size());
+    size_t capacity = buf.internalCapacity();
+
+    buf.retrieve(first.size() - 10);
+    std::string second = pattern(Buffer::kInitialSize - 20, 'A');
+    buf.append(second.data(), second.size());
+    CHECK(buf.internalCapacity() == capacity);
+    CHECK(buf.prependableBytes() == Buffer::kCheapPrepend);
+    CHECK(buf.retrieveAllAsString() == first.substr(first.size() - 10) + second);
+}
+
+// 多次 prepend / append / retrieve 交替，内容始终与参照字符串一致
+static void testMixedSequence()
+{
+    Buffer buf;
+    std::string expect;
+    for (int round = 0; round < 200; ++round)
+    {
+        std::string tail = pattern(static_cast<size_t>(round * 37 % 700 + 1), 'a');
+        buf.append(tail.data(), tail.size());
+        expect += tail;
+
+        std::string head = pattern(static_cast<size_t>(round % 13 + 1), 'A');
+        buf.prepend(head.data(), head.size());
+        expect = head + expect;
+
+        size_t take = expect.size() / 3;
+        CHECK(buf.retrieveAsString(take) == expect.substr(0, take));
+        expect.erase(0, take);
+        CHECK(buf.readableBytes() == expect.size());
+    }
+    CHECK(buf.retrieveAllAsString() == expect);
+}
+
+int main()
+{
+    testTypedRoundTrip();
+    testNetworkByteOrder();
+    testPrependTyped();
+    testPrependThenAppendPastCapacity();
+    testPrependLargerThanPrependable();
+    testCompaction();
+    testMixedSequence();
+
+    printf("test_buffer %s\n", g_failures == 0 ? "PASS" : "FAIL");
+    fflush(stdout);
+    // 日志线程是分离的常驻线程，正常析构静态对象时会卡住，直接退出
+    _exit(g_failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+
+/**
+ * 只能移动的函数对象，带较大的内联存储 (默认 64 字节)
+ *
+ * 与 std::function 相比:
+ *   - 不要求可调用对象可拷贝，std::bind 绑定的 shared_ptr / std::string / 只能移动的对象都可以直接放进来
+ *   - 可调用对象不超过 InlineSize 字节 (且移动不抛异常) 时直接构造在内部存储中，不做任何堆分配；
+ *     libstdc++ 的 std::function 只有 16 字节的内联空间，绑定一个成员函数指针加 shared_ptr 就要 new
+ *   - 超出的可调用对象退化为堆分配，行为与 std::function 一致
+ *
+ * 用于 EventLoop::Functor、定时器回调和 Channel 的事件回调，让稳定状态下的回调分发不再分配内存
+ */
+template <typename Signature, size_t InlineSize = 64>
+class InlineFunction;
+
+template <typename R, typename... Args, size_t InlineSize>
+class InlineFunction<R(Args...), InlineSize>
+{
+public:
+    InlineFunction() noexcept
+        : ops_(nullptr)
+    {}
+
+    InlineFunction(std::nullptr_t) noexcept
+        : ops_(nullptr)
+    {}
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction(F&& f)
+        : ops_(nullptr)
+    {
+        typedef typename std::decay<F>::type Functor;
+        if (isNull(f))
+        {
+            return;
+        }
+        construct<Functor>(std::forward<F>(f), std::integral_constant<bool, fitsInline<Functor>()>());
+    }
+
+    InlineFunction(InlineFunction&& rhs) noexcept
+        : ops_(rhs.ops_)
+    {
+        if (ops_)
+        {
+            ops_->move(&rhs.storage_, &storage_);
+            rhs.ops_ = nullptr;
+        }
+    }
+
+    InlineFunction& operator=(InlineFunction&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            reset();
+            if (rhs.ops_)
+            {
+                rhs.ops_->move(&rhs.storage_, &storage_);
+                ops_ = rhs.ops_;
+                rhs.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction& operator=(F&& f)
+    {
+        InlineFunction tmp(std::forward<F>(f));
+        return *this = std::move(tmp);
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction()
+    {
+        reset();
+    }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    // 与 std::function 一样，空对象调用时抛出 std::bad_function_call
+    R operator()(Args... args) const
+    {
+        if (ops_ == nullptr)
+        {
+            throw std::bad_function_call();
+        }
+        return ops_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+    // 可调用对象是否存放在内联存储中 (调试 / 统计用)
+    bool isInline() const noexcept { return ops_ != nullptr && ops_->isInline; }
+
+private:
+    typedef typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type Storage;
+
+    // 每种可调用类型一张操作表，InlineFunction 本身只多存一个指针
+    struct Ops
+    {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*move)(void* from, void* to);         // 移动到 to 并销毁 from
+        void (*destroy)(void* storage);
+        bool isInline;
+    };
+
+    template <typename Functor>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(Functor) <= InlineSize
+            && alignof(Functor) <= alignof(Storage)
+            && std::is_nothrow_move_constructible<Functor>::value;
+    }
+
+    // 空的函数指针 / std::function 构造出空的 InlineFunction
+    template <typename T>
+    static bool isNull(const T&) { return false; }
+
+    template <typename T>
+    static bool isNull(T* p) { return p == nullptr; }
+
+    template <typename Sig>
+    static bool isNull(const std::function<Sig>& f) { return !f; }
+
+    template <typename F>
+    static bool isNull(const InlineFunction<F, InlineSize>& f) { return !f; }
+
+    // 内联存储
+    template <typename Functor>
+    struct InlineOps
+    {
+        static R invoke(void* storage, Args&&... args)
+        {
+            return (*static_cast<Functor*>(storage))(std::forward<Args>(args)...);
+        }
+
+        static void move(void* from, void* to)
+        {
+            Functor* src = static_cast<Functor*>(from);
+            ::new (to) Functor(std::move(*src));
+            src->~Functor();
+        }
+
+        static void destroy(void* storage)
+        {
+            static_cast<Functor*>(storage)->~Functor();
+        }
+
+        static const Ops ops;
+    };
+
+    // 堆存储，内部存储中只放一个指针
+    template <typename Functor>
+    struct HeapOps
+    {
+        static Functor*& pointer(void* storage)
+        {
+            return *static_cast<Functor**>(storage);
+        }
+
+        static R invoke(void* storage, Args&&... args)
+        {
+            return (*pointer(storage))(std::forward<Args>(args)...);
+        }
+
+        static void move(void* from, void* to)
+        {
+            ::new (to) Functor*(pointer(from));
+        }
+
+        static void destroy(void* storage)
+        {
+            delete pointer(storage);
+        }
+
+        static const Ops ops;
+    };
+
+    template <typename Functor, typename F>
+    void construct(F&& f, std::true_type)
+    {
+        ::new (static_cast<void*>(&storage_)) Functor(std::forward<F>(f));
+        ops_ = &InlineOps<Functor>::ops;
+    }
+
+    template <typename Functor, typename F>
+    void construct(F&& f, std::false_type)
+    {
+        ::new (static_cast<void*>(&storage_)) Functor*(new Functor(std::forward<F>(f)));
+        ops_ = &HeapOps<Functor>::ops;
+    }
+
+    void reset() noexcept
+    {
+        if (ops_)
+        {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    const Ops* ops_;
+    mutable Storage storage_;               // operator() 为 const，但可调用对象本身可能有状态
+};
+
+template <typename R, typename... Args, size_t InlineSize>
+template <typename Functor>
+const typename InlineFunction<R(Args...), InlineSize>::Ops
+InlineFunction<R(Args...), InlineSize>::InlineOps<Functor>::ops = {
+    &InlineOps<Functor>::invoke, &InlineOps<Functor>::move, &InlineOps<Functor>::destroy, true
+};
+
+template <typename R, typename... Args, size_t InlineSize>
+template <typename Functor>
+const typename InlineFunction<R(Args...), InlineSize>::Ops
+InlineFunction<R(Args...), InlineSize>::HeapOps<Functor>::ops = {
+    &HeapOps<Functor>::invoke, &HeapOps<Functor>::move, &HeapOps<Functor>::destroy, false
+};
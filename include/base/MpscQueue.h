@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <stddef.h>
+
+#include "noncopyable.h"
+
+/**
+ * 多生产者单消费者队列 (EventLoop 的跨线程任务队列)
+ *
+ * 主体是 Vyukov 的有界环形队列: 每个槽位带一个序号，生产者通过 CAS 抢占 tail_ 后写入槽位，
+ * 再发布序号；消费者只有一个，按序号判断槽位是否就绪，全程无锁
+ *
+ * 环满时退化到加锁的溢出区，并置位 overflowing_，此后的生产者都进入溢出区，直到消费者把溢出区取空，
+ * 保证同一个生产者先后放入的元素按顺序被取出 (环中的元素总是先于溢出区被取出)
+ *
+ * T 需要可默认构造、可移动
+ */
+template <typename T>
+class MpscQueue : noncopyable
+{
+public:
+    static const size_t kDefaultCapacity = 1024;
+
+    // capacity 会向上取整到 2 的幂
+    explicit MpscQueue(size_t capacity = kDefaultCapacity)
+        : mask_(roundUpPowerOfTwo(capacity) - 1)
+        , cells_(new Cell[mask_ + 1])
+        , tail_(0)
+        , head_(0)
+        , overflowing_(false)
+    {
+        for (size_t i = 0; i <= mask_; ++i)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpscQueue()
+    {
+        delete[] cells_;
+    }
+
+    // 任意线程调用
+    void push(T&& value)
+    {
+        if (!overflowing_.load(std::memory_order_acquire) && tryPush(value))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(overflowMutex_);
+        overflow_.push_back(std::move(value));
+        overflowing_.store(true, std::memory_order_release);
+    }
+
+    // 只能由消费者线程调用: 把当前可见的所有元素按顺序追加到 out 中，返回取出的个数
+    size_t popAll(std::vector<T>* out)
+    {
+        size_t count = 0;
+        for (;;)
+        {
+            Cell& cell = cells_[head_ & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != head_ + 1)
+            {
+                break;
+            }
+            out->push_back(std::move(cell.value));
+            cell.value = T();
+            cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+            ++head_;
+            ++count;
+        }
+
+        if (overflowing_.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(overflowMutex_);
+            for (T& value : overflow_)
+            {
+                out->push_back(std::move(value));
+            }
+            count += overflow_.size();
+            overflow_.clear();
+            overflowing_.store(false, std::memory_order_release);
+        }
+        return count;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;   // == 下标: 空闲可写; == 下标 + 1: 已写入可读
+        T value;
+    };
+
+    static size_t roundUpPowerOfTwo(size_t n)
+    {
+        size_t size = 2;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    bool tryPush(T& value)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // 环已满
+                return false;
+            }
+            else
+            {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    const size_t mask_;
+    Cell* const cells_;
+
+    // 生产者与消费者各自修改的下标放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<size_t> tail_;                      // 生产者竞争的写位置
+    alignas(64) size_t head_;                                   // 消费者独占的读位置
+
+    alignas(64) std::atomic_bool overflowing_;                  // 溢出区非空
+    std::mutex overflowMutex_;
+    std::vector<T> overflow_;                                   // 环满时的溢出区
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <string.h>
+
+/**
+ * 一段只读内存的视图 (指针 + 长度)，不拥有数据
+ * 用于 TcpConnection::send 的分散写接口，调用方可以把响应头、响应体等不连续的内存直接交给 writev，
+ * 无需先拼接成一个缓冲区；Slice 指向的内存必须在 send 返回之前保持有效
+ */
+class Slice
+{
+public:
+    Slice()
+        : data_("")
+        , size_(0)
+    {}
+
+    Slice(const char* data, size_t size)
+        : data_(data)
+        , size_(size)
+    {}
+
+    Slice(const char* str)
+        : data_(str)
+        , size_(strlen(str))
+    {}
+
+    Slice(const std::string& str)
+        : data_(str.data())
+        , size_(str.size())
+    {}
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    std::string toString() const { return std::string(data_, size_); }
+
+private:
+    const char* data_;
+    size_t size_;
+};
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include <sys/time.h>
+#include <stdint.h>
 
 class Timestamp
 {
@@ -10,8 +11,16 @@ public:
     Timestamp();
     explicit Timestamp(int64_t microSecondsSinceEpoch);
 
+    // 当前的墙上时间 (gettimeofday，微秒)
     static Timestamp now();
-    static Timestamp now1();
+    // 与 now() 相同，保留旧的名字
+    static Timestamp now1() { return now(); }
+
+    /**
+     * 单调时钟 (CLOCK_MONOTONIC，微秒)，不受系统时间调整的影响，定时器内部使用
+     * 只能与同样来自 monotonic() 的时间比较，不能格式化成日期
+     */
+    static Timestamp monotonic();
 
     // 按照规定格式返回  "%4d/%02d/%02d %02d:%02d:%02d"
     std::string toString() const;
@@ -38,6 +47,8 @@ public:
         return Timestamp();
     }
 
+    bool valid() const { return microSecondsSinceEpoch_ > 0; }
+
     // 1秒=1000*1000微妙
     static const int kMicroSecondsPerSecond = 1000 * 1000;
 
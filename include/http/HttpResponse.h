@@ -2,6 +2,10 @@
 
 #include <unordered_map>
 #include <string>
+#include <sys/types.h>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
 
 
 class Buffer;
@@ -46,7 +50,7 @@ Content-Type: text/html; charset=UTF-8
 */
 
 
-class HttpResponse
+class HttpResponse : noncopyable
 {
 public:
     // HTTP响应状态码
@@ -62,8 +66,13 @@ public:
     explicit HttpResponse(bool close)
         : statusCode_(kUnknown)
         , closeConnection_(close)
+        , fileFd_(-1)
+        , fileOffset_(0)
+        , fileLength_(0)
     {}   
 
+    ~HttpResponse();
+
     // 设置响应状态码
     void setStatusCode(HttpStatusCode code)
     { statusCode_ = code; } 
@@ -90,21 +99,61 @@ public:
         addHeader("Content-Type", contentType); 
     } 
 
+    /**
+     * 设置 Date 头部的时间 (墙上时间，HttpServer 使用请求所在这一轮 poll 返回的时间)
+     * 格式化后的头部按线程缓存，每秒只格式化一次
+     */
+    void setDate(Timestamp now)
+    { date_ = now; }
+
      // 添加一个头部字段
     void addHeader(const std::string& key, const std::string& value)
     { 
         headers_[key] = value;
     }  
 
+    // 获取响应体
+    const std::string& body() const
+    { return body_; }
+
+    /**
+     * 以文件作为响应体 (静态资源)，HttpServer 会通过 sendfile 发送，文件内容不会读入用户态
+     * 打开失败返回 false；设置后 setBody 设置的内容被忽略
+     */
+    bool setBodyFile(const std::string& path);
+
+    bool hasBodyFile() const
+    { return fileFd_ >= 0; }
+
+    int bodyFileFd() const
+    { return fileFd_; }
+
+    off_t bodyFileOffset() const
+    { return fileOffset_; }
+
+    size_t bodyFileLength() const
+    { return fileLength_; }
+
+    // 响应体长度，用于 Content-Length
+    size_t bodyLength() const
+    { return hasBodyFile() ? fileLength_ : body_.size(); }
+
     // 将响应内容写入缓冲区打包好
     void appendToBuffer(Buffer* output) const;
 
+    // 只把状态行和头部 (含空行) 写入缓冲区，响应体由调用方通过分散写直接发送，省去一次拷贝
+    void appendHeadersToBuffer(Buffer* output) const;
+
 private:
     std::unordered_map<std::string, std::string> headers_;          // 头部字段集合
     HttpStatusCode statusCode_;                                     // 响应状态码
     std::string statusMessage_;                                     // 响应状态消息
     bool closeConnection_;                                          // 是否关闭连接
     std::string body_;                                              // 响应体
+    int fileFd_;                                                    // 文件响应体，-1 表示没有
+    off_t fileOffset_;                                              // 文件响应体起始偏移
+    size_t fileLength_;                                             // 文件响应体长度
+    Timestamp date_;                                                // Date 头部的时间，无效时不输出
 };
 
 
@@ -2,27 +2,38 @@
 
 #include <string>
 #include <atomic>
+#include <utility>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "noncopyable.h"
 #include "lockqueue.h"
 
 
 /*
+* @         TRACE: 跟踪信息 (事件循环每一轮 / 每个事件的细节)
+* @         DEBUG: 调试信息
 * @         INFO : 普通信息
 * @         ERROR: 错误信息
 * @         FATAL: core信息
-* @         DEBUG: 调试信息
+*
+* 级别按严重程度递增，低于当前日志级别的日志不会被格式化，也不会进入缓冲队列
+* TRACE / DEBUG 只在定义了 MUDEBUG 时编译，发布版本中整条语句 (包括参数求值) 都不存在
 */
 
 
 enum LogLevel
 {
+    TRACE,
+    DEBUG,
     INFO,
     ERROR,
     FATAL,
-    DEBUG,
 };
 
+// 当前日志级别，默认 INFO，宏在格式化之前检查
+extern std::atomic<int> g_logLevel;
+
 // 异步日志系统  (单例模式)
 class Logger
 {
@@ -31,15 +42,16 @@ public:
     // 获取日志唯一实例对象
     static Logger& instance();
 
-    // 设置日志级别
-    void setLogLevel(int level);
+    // 设置 / 获取日志级别，低于该级别的日志被丢弃，可以在运行时修改
+    static void setLogLevel(int level) { g_logLevel.store(level, std::memory_order_relaxed); }
+    static int logLevel() { return g_logLevel.load(std::memory_order_relaxed); }
 
     // 写日志
-    void log(std::string msg);
+    void log(int level, const std::string& msg);
 
 private:
-    int logLevel_;                          // 记录日志级别
-    LockQueue<std::string> m_lckQue;        // 日志缓冲队列
+    using LogEntry = std::pair<int, std::string>;   // 日志级别 + 日志内容
+    LockQueue<LogEntry> m_lckQue;                   // 日志缓冲队列
 
     Logger();
 };
@@ -49,50 +61,34 @@ private:
     使用方法：
     LOG_INFO("%s, %d", arg1, arg2);
 */
-#define LOG_INFO(logmsgFormat, ...)                             \
+#define LOG_LEVEL_(level, logmsgFormat, ...)                    \
     do                                                          \
     {                                                           \
-        Logger &logger = Logger::instance();                    \
-        logger.setLogLevel(INFO);                               \
-        char buf[1024] = {0};                                   \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);       \
-        logger.log(buf);                                        \
+        if (Logger::logLevel() <= level)                        \
+        {                                                       \
+            char buf[1024] = {0};                               \
+            snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);   \
+            Logger::instance().log(level, buf);                 \
+        }                                                       \
     } while (0)
 
-#define LOG_ERROR(logmsgFormat, ...)                            \
-    do                                                          \
-    {                                                           \
-        Logger &logger = Logger::instance();                    \
-        logger.setLogLevel(ERROR);                              \
-        char buf[1024] = {0};                                   \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);       \
-        logger.log(buf);                                        \
-    } while (0)
+#define LOG_INFO(logmsgFormat, ...) LOG_LEVEL_(INFO, logmsgFormat, ##__VA_ARGS__)
+
+#define LOG_ERROR(logmsgFormat, ...) LOG_LEVEL_(ERROR, logmsgFormat, ##__VA_ARGS__)
 
 #define LOG_FATAL(logmsgFormat, ...)                            \
     do                                                          \
     {                                                           \
-        Logger &logger = Logger::instance();                    \
-        logger.setLogLevel(FATAL);                              \
         char buf[1024] = {0};                                   \
         snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);       \
-        logger.log(buf);                                        \
+        Logger::instance().log(FATAL, buf);                     \
         exit(-1);                                               \
     } while (0)
 
 #ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...)                            \
-    do                                                          \
-    {                                                           \
-        Logger &logger = Logger::instance();                    \
-        logger.setLogLevel(DEBUG);                              \
-        char buf[1024] = {0};                                   \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__);       \
-        logger.log(buf);                                        \
-    } while (0)
+    #define LOG_DEBUG(logmsgFormat, ...) LOG_LEVEL_(DEBUG, logmsgFormat, ##__VA_ARGS__)
+    #define LOG_TRACE(logmsgFormat, ...) LOG_LEVEL_(TRACE, logmsgFormat, ##__VA_ARGS__)
 #else
-    #define LOG_DEBUG(logmsgFormat, ...) 
+    #define LOG_DEBUG(logmsgFormat, ...)
+    #define LOG_TRACE(logmsgFormat, ...)
 #endif
-
-
-
@@ -1,8 +1,12 @@
 #pragma once
 
-#include <vector>
 #include <string>
 #include <algorithm>
+#include <string.h>
+#include <stdint.h>
+#include <endian.h>
+
+#include "BufferPool.h"
 
 
 /// 缓冲区类模型
@@ -14,22 +18,75 @@
 /// |                   |     (CONTENT)    |                  |
 /// +-------------------+------------------+------------------+
 /// |                   |                  |                  |
-/// 0      <=      readerIndex   <=   writerIndex    <=     size
+/// 0      <=      readerIndex   <=   writerIndex    <=     capacity
 /// @endcode
+///
+/// 存储空间从所在线程 EventLoop 的 BufferPool 中申请，并且是惰性分配的:
+/// 构造时不分配内存，第一次写入 (通常发生在 subloop 线程) 才申请，析构时归还给当前线程的内存池
 
 // 网络层底层的缓冲器类型
 class Buffer
 {
 public:
-    // 说明缓冲区中共可以存 1032 字节
+    // 预置区 + 初始区 正好是 BufferPool 最小的 1K size class
     static const size_t kCheapPrepend = 8;                          // 预置大小
-    static const size_t kInitialSize = 1024;                        // 初始大小
+    static const size_t kInitialSize = 1024 - kCheapPrepend;        // 初始大小
+    // readFd 自适应预留的上限，预置区 + 预留正好是 64K size class，读空后的缓冲区不会进入 128K，
+    // 也就不会超过 TcpConnection 默认的常驻容量上限而反复收缩 / 重新申请
+    static const size_t kMaxReadSizeHint = 64 * 1024 - kCheapPrepend;
 
     explicit Buffer(size_t initialSize = kInitialSize)
-        : buffer_(kInitialSize + initialSize)
+        : buffer_(nullptr)
+        , capacity_(0)
+        , initialSize_(initialSize)
+        , readSizeHint_(initialSize)
         , readerIndex_(kCheapPrepend)
         , writerIndex_(kCheapPrepend)
-    {}
+    {
+        resetScanIndex();
+    }
+
+    ~Buffer()
+    {
+        releaseStorage();
+    }
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    // 移动时直接接管存储空间，不拷贝数据
+    Buffer(Buffer&& rhs)
+        : buffer_(rhs.buffer_)
+        , capacity_(rhs.capacity_)
+        , initialSize_(rhs.initialSize_)
+        , readSizeHint_(rhs.readSizeHint_)
+        , readerIndex_(rhs.readerIndex_)
+        , writerIndex_(rhs.writerIndex_)
+    {
+        std::copy(rhs.scanIndex_, rhs.scanIndex_ + kNumScanKinds, scanIndex_);
+        rhs.buffer_ = nullptr;
+        rhs.capacity_ = 0;
+        rhs.readerIndex_ = kCheapPrepend;
+        rhs.writerIndex_ = kCheapPrepend;
+        rhs.resetScanIndex();
+    }
+
+    Buffer& operator=(Buffer&& rhs)
+    {
+        swap(rhs);
+        return *this;
+    }
+
+    void swap(Buffer& rhs)
+    {
+        std::swap(buffer_, rhs.buffer_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(initialSize_, rhs.initialSize_);
+        std::swap(readSizeHint_, rhs.readSizeHint_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap_ranges(scanIndex_, scanIndex_ + kNumScanKinds, rhs.scanIndex_);
+    }
 
     // 可读数据大小(长度)
     size_t readableBytes() const
@@ -37,10 +94,16 @@ public:
         return writerIndex_ - readerIndex_;
     }
 
-    // 可写数据大小(长度)
+    // 可写数据大小(长度)，尚未分配存储时为 0
     size_t writableBytes() const
     {
-        return buffer_.size() - writerIndex_;
+        return capacity_ > writerIndex_ ? capacity_ - writerIndex_ : 0;
+    }
+
+    // 当前持有的存储空间大小
+    size_t internalCapacity() const
+    {
+        return capacity_;
     }
 
     // 预置区域大小
@@ -68,6 +131,7 @@ public:
     {
         readerIndex_ = kCheapPrepend;
         writerIndex_ = kCheapPrepend;
+        resetScanIndex();
     }
 
     // DEBUG使用，提取出string类型，但是不会置位
@@ -92,7 +156,25 @@ public:
         return result;
     }
 
-    // buffer_.size() - writerIndex_ 可写区域已经不够写入，则进行扩容
+    // 收缩存储空间，只保留可读数据和 reserve 字节的可写区域
+    // 没有可读数据且 reserve 为 0 时，把存储全部归还给内存池，下次写入时再重新申请
+    void shrink(size_t reserve)
+    {
+        if (readableBytes() == 0 && reserve == 0)
+        {
+            releaseStorage();
+            retrieveAll();
+            return;
+        }
+
+        size_t newCapacity = BufferPool::roundUp(kCheapPrepend + readableBytes() + reserve);
+        if (newCapacity < capacity_)
+        {
+            reallocate(newCapacity);
+        }
+    }
+
+    // capacity_ - writerIndex_ 可写区域已经不够写入，则进行扩容
     void ensureWriteableBytes(size_t len)
     {
         if (writableBytes() < len)
@@ -106,9 +188,150 @@ public:
     void append(const char* data, size_t len)
     {
         ensureWriteableBytes(len);
-        std::copy(data, data + len, beginWrite());
+        memcpy(beginWrite(), data, len);
         writerIndex_ += len;
     }
+
+    void append(const void* data, size_t len)
+    {
+        append(static_cast<const char*>(data), len);
+    }
+
+    /**
+     * 定长整数的读写，全部使用网络字节序 (大端)
+     *   appendIntXX  追加到可写区域
+     *   peekIntXX    只读取不移动 readerIndex_，调用前需保证 readableBytes() 足够
+     *   readIntXX    读取并 retrieve
+     *   prependIntXX 写入预置区域
+     */
+    void appendInt64(int64_t x)
+    {
+        int64_t be64 = htobe64(x);
+        append(&be64, sizeof be64);
+    }
+
+    void appendInt32(int32_t x)
+    {
+        int32_t be32 = htobe32(x);
+        append(&be32, sizeof be32);
+    }
+
+    void appendInt16(int16_t x)
+    {
+        int16_t be16 = htobe16(x);
+        append(&be16, sizeof be16);
+    }
+
+    void appendInt8(int8_t x)
+    {
+        append(&x, sizeof x);
+    }
+
+    int64_t peekInt64() const
+    {
+        int64_t be64 = 0;
+        memcpy(&be64, peek(), sizeof be64);
+        return be64toh(be64);
+    }
+
+    int32_t peekInt32() const
+    {
+        int32_t be32 = 0;
+        memcpy(&be32, peek(), sizeof be32);
+        return be32toh(be32);
+    }
+
+    int16_t peekInt16() const
+    {
+        int16_t be16 = 0;
+        memcpy(&be16, peek(), sizeof be16);
+        return be16toh(be16);
+    }
+
+    int8_t peekInt8() const
+    {
+        return *peek();
+    }
+
+    int64_t readInt64()
+    {
+        int64_t result = peekInt64();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int32_t readInt32()
+    {
+        int32_t result = peekInt32();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int16_t readInt16()
+    {
+        int16_t result = peekInt16();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int8_t readInt8()
+    {
+        int8_t result = peekInt8();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    /**
+     * 把 [data, data + len] 写到可读数据之前
+     * 编解码器可以先 append 消息体，再把长度头 prepend 到前面，len 不超过 prependableBytes() 时没有任何额外拷贝
+     * (默认预留的 kCheapPrepend 正好放得下一个 int64)；预置区不够时才会整体后移可读数据
+     */
+    void prepend(const void* data, size_t len)
+    {
+        if (buffer_ == nullptr)
+        {
+            makeSpace(len);
+        }
+
+        if (len > prependableBytes())
+        {
+            size_t readable = readableBytes();
+            ensureWriteableBytes(len);
+            char* start = begin() + readerIndex_;
+            memmove(start + len, start, readable);
+            writerIndex_ += len;
+            readerIndex_ += len;
+        }
+
+        readerIndex_ -= len;
+        memcpy(begin() + readerIndex_, data, len);
+
+        // 新数据插在已扫描区域之前，之前记住的扫描位置不再可信
+        resetScanIndex();
+    }
+
+    void prependInt64(int64_t x)
+    {
+        int64_t be64 = htobe64(x);
+        prepend(&be64, sizeof be64);
+    }
+
+    void prependInt32(int32_t x)
+    {
+        int32_t be32 = htobe32(x);
+        prepend(&be32, sizeof be32);
+    }
+
+    void prependInt16(int16_t x)
+    {
+        int16_t be16 = htobe16(x);
+        prepend(&be16, sizeof be16);
+    }
+
+    void prependInt8(int8_t x)
+    {
+        prepend(&x, sizeof x);
+    }
     
     // 返回缓冲区中可读数据的起始地址
     const char* peek() const 
@@ -129,14 +352,26 @@ public:
     // 从 fd 上读取数据
     ssize_t  readFd(int fd, int* saveErrno);
 
+    // readFd 每次预留的可写大小，随本连接的读取情况自适应调整
+    size_t readSizeHint() const { return readSizeHint_; }
+
     // 通过 fd 发送数据
     ssize_t  writeFd(int fd, int* saveErrno);
 
-    // 在缓冲区中查找 CRLF (\r\n) 的位置
-    const char* findCRLF() const {
-        const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF + 2);
-        return crlf == beginWrite() ? nullptr : crlf;
-    }
+    /**
+     * 分隔符查找，找不到返回 nullptr
+     * 底层按 CPU 能力在运行时选择 AVX2 / SSE2 / 标量实现
+     *
+     * 不带 start 参数的版本会记住上一次扫描到的位置: 数据不完整 (没找到) 时，
+     * 下一次调用只从新到达的数据开始扫描，已经检查过的字节不会被重复扫描
+     */
+    const char* findCRLF() const;                                   // 查找 "\r\n"
+    const char* findCRLF(const char* start) const;
+    const char* findEOL() const;                                    // 查找 "\n"
+    const char* findEOL(const char* start) const;
+    const char* findDoubleCRLF() const;                             // 查找 "\r\n\r\n" (HTTP 头部结束)
+    const char* find(char c) const;                                 // 查找任意单个字符
+    const char* find(const char* start, char c) const;
 
     // 从缓冲区中提取数据，直到指定的终止位置
     void retrieveUntil(const char* end) {
@@ -144,26 +379,93 @@ public:
     }
 
 private:
+    // 每种分隔符各自记录一个扫描位置
+    enum ScanKind
+    {
+        kScanCRLF,
+        kScanEOL,
+        kScanDoubleCRLF,
+        kNumScanKinds,
+    };
+
+    // 带记忆的查找: 从 max(readerIndex_, scanIndex_[kind]) 开始扫描 patternLen 长的分隔符
+    const char* findWithMemo(ScanKind kind, size_t patternLen) const;
+
+    void resetScanIndex()
+    {
+        std::fill(scanIndex_, scanIndex_ + kNumScanKinds, 0);
+    }
+
+    // 可读数据即将被搬到 kCheapPrepend 处，扫描位置随之平移
+    void rebaseScanIndex()
+    {
+        for (int i = 0; i < kNumScanKinds; ++i)
+        {
+            scanIndex_[i] = scanIndex_[i] > readerIndex_ ? scanIndex_[i] - readerIndex_ + kCheapPrepend : 0;
+        }
+    }
+
     char* begin()
     {
         // 数组的起始地址
-        return &*buffer_.begin();
+        return buffer_;
     }
 
     const char* begin() const 
     {
-        return &*buffer_.begin();
+        return buffer_;
+    }
+
+    // 根据本次 readv 读到的字节数调整 readSizeHint_
+    void adjustReadSizeHint(size_t n, size_t writable);
+
+    // 把存储空间归还给内存池
+    void releaseStorage()
+    {
+        if (buffer_)
+        {
+            BufferPool::release(buffer_, capacity_);
+            buffer_ = nullptr;
+            capacity_ = 0;
+        }
+    }
+
+    // 重新申请一块至少 newCapacity 大小的存储，并把可读数据搬到 kCheapPrepend 处
+    void reallocate(size_t newCapacity)
+    {
+        size_t readable = readableBytes();
+        size_t actual = 0;
+        char* newBuffer = static_cast<char*>(BufferPool::alloc(newCapacity, &actual));
+        if (readable > 0)
+        {
+            memcpy(newBuffer + kCheapPrepend, peek(), readable);
+        }
+        rebaseScanIndex();
+        releaseStorage();
+
+        buffer_ = newBuffer;
+        capacity_ = actual;
+        readerIndex_ = kCheapPrepend;
+        writerIndex_ = readerIndex_ + readable;
     }
     
     // 扩容
     void makeSpace(size_t len)
     {
+        // 第一次写入才真正申请存储空间
+        if (buffer_ == nullptr)
+        {
+            reallocate(kCheapPrepend + std::max(initialSize_, len));
+            return;
+        }
+
         /**
          *   kCheapPrepend   |   reader   |   wridter   |
          *   kCheapPrepend   |           len            |
          */
-        // if  : 可写区域 + 可读区域 - kCheapPrepend(预置区域) < len 
+        // if  : 可写区域 + 可读区域 < len + kCheapPrepend(预置区域)
         // else: 整个 buffer 够用， 将已经读取后的 readable 移动到前面继续分配
+        // prepend 之后 readerIndex_ 可能小于 kCheapPrepend，不能写成先减 kCheapPrepend (无符号数会下溢)
         /**
          * 
          * kCheapPrepend   |   reader      |   wridter   |
@@ -171,26 +473,30 @@ private:
          *                     readerIndex_
          *     思路是 已读 + wridter 与 len 比较
         */
-        if (writableBytes() + prependableBytes() - kCheapPrepend < len)
+        if (writableBytes() + prependableBytes() < len + kCheapPrepend)
         {
-            buffer_.resize(writerIndex_ + len);
+            // 至少翻倍，保证多次 append 的均摊复杂度
+            reallocate(std::max(writerIndex_ + len, capacity_ * 2));
         }
         else
         {
             size_t readalbe = readableBytes();
-            std::copy(begin() + readerIndex_
-                    , begin() + writerIndex_
-                    , begin() + kCheapPrepend);
+            rebaseScanIndex();
+            // readerIndex_ 小于 kCheapPrepend 时是向后移动，源与目标区域重叠，用 memmove
+            memmove(begin() + kCheapPrepend, begin() + readerIndex_, readalbe);
             readerIndex_ = kCheapPrepend;
             writerIndex_ = readerIndex_ + readalbe;
         }
     }
 
-    std::vector<char> buffer_;              // buffer 缓冲区
+    char* buffer_;                          // buffer 缓冲区 (来自 BufferPool)
+    size_t capacity_;                       // buffer_ 的大小 (size class 大小)
+    size_t initialSize_;                    // 第一次分配时的大小
+    size_t readSizeHint_;                   // readFd 预留的可写大小
     size_t readerIndex_;                    // 可读区域头下标
     size_t writerIndex_;                    // 可写区域头下标
 
-    static const char kCRLF[];
+    mutable size_t scanIndex_[kNumScanKinds];   // 各类分隔符已经扫描到的位置 (下标)
 
 };
 
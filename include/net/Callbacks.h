@@ -14,4 +14,5 @@ using CloseCallback = std::function<void(const TcpConnectionPtr&)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr&)>;
 using MessageCallback = std::function<void(const TcpConnectionPtr&, Buffer*, Timestamp)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t)>;
+using LowWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t)>;
 
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "noncopyable.h"
+
+
+/// 链式缓冲区模型
+///
+/// @code
+///   head_                                                     tail_
+///     |                                                         |
+/// +-----------------------+    +-----------------------+    +-----------------------+
+/// |  已读  |    可读字节    | -> |        可读字节        | -> |  可读字节  |  可写字节  |
+/// +-----------------------+    +-----------------------+    +-----------------------+
+///          |                                                           |
+///     readerIndex                                                 writerIndex
+/// @endcode
+///
+/// 由若干固定大小的块 (Block) 串成单链表，块从所在线程的 BufferPool 中申请:
+///   append   只在尾块后面追加，尾块写满就再挂一个新块，已有数据永远不会被搬移
+///   retrieve 只移动头块的读下标，头块读空后直接释放
+///   可读区域可以整体导出为 iovec 数组，交给 writev 一次系统调用全部发出
+
+// 网络层发送方向的缓冲器类型 (不要求数据连续)
+class ChainBuffer : noncopyable
+{
+public:
+    static const size_t kBlockSize = 4096;                          // 每个块的大小 (含块头)，对应 BufferPool 的 4K size class
+
+    explicit ChainBuffer(size_t blockSize = kBlockSize);
+    ~ChainBuffer();
+
+    // 可读数据大小(长度)
+    size_t readableBytes() const { return readable_; }
+
+    // 当前挂在链表上的块数
+    size_t blockCount() const { return blockCount_; }
+
+    // 把 [data, data + len] 内存上的数据，追加到链表尾部
+    void append(const char* data, size_t len);
+    void append(const std::string& str) { append(str.data(), str.size()); }
+
+    // 从头部丢弃 len 字节的可读数据，读空的块直接释放
+    void retrieve(size_t len);
+
+    // 释放所有块
+    void retrieveAll();
+
+    // 从 buffer 中取出长度为 len 的字节的数据
+    std::string retrieveAsString(size_t len);
+    std::string retrieveAllAsString() { return retrieveAsString(readableBytes()); }
+
+    // 把可读区域按块顺序填入 iov，最多 maxIov 个，返回实际填充的个数
+    int peekIovec(struct iovec* iov, int maxIov) const;
+
+    // 从 fd 上读取数据
+    ssize_t readFd(int fd, int* saveErrno);
+
+    // 通过 writev 把所有可读数据一次性交给内核，不会 retrieve
+    ssize_t writeFd(int fd, int* saveErrno) { return writeFd(fd, readable_, saveErrno); }
+
+    // 同上，但最多只写出前 maxBytes 字节 (输出队列中排在文件段之前的部分)
+    // 一次最多交给内核 IOV_MAX 个块，实际交出的字节数写入 *offeredBytes；写出的字节数等于它说明套接字还没满
+    ssize_t writeFd(int fd, size_t maxBytes, int* saveErrno, size_t* offeredBytes = nullptr);
+
+private:
+    // 块头部与数据区一起分配，数据区紧跟在块头之后
+    struct Block
+    {
+        Block* next;
+        size_t readerIndex;
+        size_t writerIndex;
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    Block* newBlock();
+    void freeBlock(Block* block);
+
+    // 尾块剩余可写的大小
+    size_t tailWritable() const { return tail_ ? dataSize_ - tail_->writerIndex : 0; }
+
+    const size_t blockSize_;                // 每块的大小 (含块头)
+    const size_t dataSize_;                 // 每块数据区的大小
+    Block* head_;                           // 第一个含有可读数据的块
+    Block* tail_;                           // 最后一个块，append 写入的位置
+    size_t readable_;                       // 所有块可读字节之和
+    size_t blockCount_;                     // 链表中的块数
+};
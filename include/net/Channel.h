@@ -2,9 +2,11 @@
 
 #include "noncopyable.h"
 #include "Timestamp.h"
+#include "InlineFunction.h"
 
 #include <functional>
 #include <memory>
+#include <stdint.h>
 
 class EventLoop;
 
@@ -17,9 +19,9 @@ class EventLoop;
 class Channel : noncopyable
 {
 public:
-    // 具体绑定的回调
-    using EventCallback = std::function<void()>;
-    using ReadEventCallback = std::function<void(Timestamp)>;
+    // 具体绑定的回调 (只能移动，内联存储，设置和分发都不分配内存)
+    using EventCallback = InlineFunction<void()>;
+    using ReadEventCallback = InlineFunction<void(Timestamp)>;
 
     Channel(EventLoop *loop, int fd);
     ~Channel();
@@ -47,16 +49,30 @@ public:
     void enableWriting() { events_ |= kWriteEvent; update(); }          // 启用写事件
     void disableWriting() { events_ &= ~kWriteEvent; update(); }        // 禁用写事件
     void disableAll() { events_ = kNoneEvent; update(); }               // 禁用所有事件
+    void enableAll() { events_ |= kReadEvent | kWriteEvent; update(); } // 同时启用读写事件 (只更新一次 poller)
 
     // 返回 fd 当前事件状态
     bool isNoneEvent() const { return events_ == kNoneEvent; }          // 检查当前事件是否没有任何事件（即无事件发生）
     bool isWriting() const { return events_ & kWriteEvent; }            // 检查当前事件是否包含写事件。
     bool isReading() const { return events_ & kReadEvent; }             // 检查当前事件是否包含读事件。
 
+    /**
+     * 边缘触发 (EPOLLET)，在下一次向 poller 注册 / 修改时生效
+     * 同一次就绪只通知一次，回调必须自己把 fd 读 / 写到 EAGAIN，否则剩下的数据不会再有通知
+     */
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+    bool isEdgeTriggered() const { return edgeTriggered_; }
+
     // 
     int index() { return index_; }
     void set_index(int idx) { index_ = idx; }
 
+    // 以下由 Poller 维护: 已经提交给内核的事件、是否在等待提交的修改列表中
+    uint32_t registeredEvents() const { return registeredEvents_; }
+    void set_registeredEvents(uint32_t events) { registeredEvents_ = events; }
+    bool pendingUpdate() const { return pendingUpdate_; }
+    void set_pendingUpdate(bool on) { pendingUpdate_ = on; }
+
     // one loop per thread
     EventLoop* ownerLoop() { return loop_; }
     void remove();
@@ -77,6 +93,9 @@ private:
     int events_;                            // 注册 fd 感兴趣的事件
     int revents_;                           // poller 返回具体发生的事件
     int index_;                             // 表示 kNew / kAdded / kDeleted
+    bool edgeTriggered_;                    // 是否以边缘触发方式注册
+    uint32_t registeredEvents_;             // 已提交给内核的事件
+    bool pendingUpdate_;                    // 关注事件的修改尚未提交
 
     std::weak_ptr<void> tie_;
     bool tied_;
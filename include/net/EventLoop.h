@@ -10,6 +10,9 @@
 #include "noncopyable.h"
 #include "TimerQueue.h"
 #include "Timestamp.h"
+#include "BufferPool.h"
+#include "MpscQueue.h"
+#include "InlineFunction.h"
 
 class Channel;
 class Poller;
@@ -19,7 +22,8 @@ class Poller;
 class EventLoop : noncopyable
 {
 public:
-    using Functor = std::function<void()>;
+    // 只能移动、带 64 字节内联存储的回调类型，投递常见的 bind(成员函数, shared_ptr, ...) 不会分配内存
+    using Functor = InlineFunction<void()>;
 
     EventLoop();
     ~EventLoop();
@@ -32,15 +36,41 @@ public:
 
     Timestamp poolReturnTime() const { return pollReturnTime_; }
 
+    /**
+     * 本轮 poll 返回时读取的单调时钟 (Timestamp::monotonic())，每轮只读一次，只能在 loop 线程中使用
+     * 回调中需要 "当前时间" 但不要求精确到本回调时 (活跃时间、超时判断等) 用它代替读时钟
+     */
+    Timestamp loopTime() const { return loopTime_; }
+
     // 把 cb 放入队列中执行 cb
     void runInLoop(Functor cb);
 
     // 把 cb 放入队列中，唤醒 loop 所在的线程的，执行 cb
     void queueInLoop(Functor cb);
 
-    // 唤醒 loop 所在的线程的
+    // 唤醒 loop 所在的线程的 (loop 处理回调之前的重复唤醒会被合并，只写一次 eventfd)
     void wakeup();
 
+    // 唤醒统计: 实际写 eventfd 的次数 / 因已有唤醒未处理而省掉的次数
+    uint64_t wakeupsIssued() const { return wakeupsIssued_.load(std::memory_order_relaxed); }
+    uint64_t wakeupsSuppressed() const { return wakeupsSuppressed_.load(std::memory_order_relaxed); }
+
+    // Poller 统计: 等待调用次数 / 返回的就绪事件总数 / 修改关注事件的系统调用次数
+    uint64_t pollCalls() const;
+    uint64_t pollEvents() const;
+    uint64_t pollerCtlCalls() const;
+
+    // Poller 后端是否支持边缘触发 (poll 后端不支持)
+    bool supportsEdgeTriggered() const;
+
+    /**
+     * 自适应忙轮询 (需在 loop() 之前设置)
+     * 最近 micros 微秒内有过 IO 事件或回调时，用 epoll_wait(0) 空转而不阻塞，
+     * 省掉线程睡眠 / 唤醒的延迟；超过该时间没有任何活动再回到阻塞等待
+     * 会持续占用一个 CPU，只适合对延迟敏感的 loop，0 表示关闭 (默认)
+     */
+    void setBusyPollMicros(int64_t micros) { busyPollMicros_ = micros; }
+
     // EventLoop 调用 Poller 的方法
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
@@ -48,23 +78,42 @@ public:
 
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
 
+    // 本 loop 的缓冲区内存池 (Buffer / ChainBuffer 的存储从这里申请)
+    BufferPool* bufferPool() { return &bufferPool_; }
+
 
     // ---------------- 定时器相关 --------------------
     // Functor 传参时尽量使用 move 这类不需要执行具体拷贝的语法，可以大大提高效率
-    // 在指定的 timestamp 时间点执行回调函数 cb
-    void runAt(Timestamp timestamp, Functor&& cb);
+    // 返回的 TimerId 可以在任意线程取消定时器 (cancel) 或者修改到期时间 (reset)
+    // 定时器内部使用单调时钟，修改系统时间不影响已经设置的定时器
+    // 在指定的 timestamp 时间点 (墙上时间，例如 Timestamp::now() 加上一段时间) 执行回调函数 cb
+    TimerId runAt(Timestamp timestamp, Functor&& cb);
 
     // 在当前时间 waitTime 秒之后执行回调函数 cb
-    void runAfter(double waitTime, Functor&& cb);
+    TimerId runAfter(double waitTime, Functor&& cb);
 
     // 以 interval 秒为周期，定期执行回调函数 cb
-    void runEvery(double interval, Functor&& cb);
+    TimerId runEvery(double interval, Functor&& cb);
+
+    /**
+     * 选择本 loop 定时器的存储结构，默认红黑树 (TimerQueue::kTimerTree)
+     * 大量连接各自带超时定时器时可以换成分层时间轮 (TimerQueue::kTimerWheel)，插入 / 到期 O(1)，精度为毫秒
+     * 可以在任意线程、任意时刻调用，已有的定时器会迁移过去
+     */
+    void setTimerEngine(TimerQueue::EngineType type);
+
+    /**
+     * 是否使用 timerfd 唤醒定时器，默认 true
+     * false 时不再创建 timerfd，把最早的到期时间并入 poll 的超时 (精度为毫秒)，
+     * 每次到期少一个 fd 事件以及 read / timerfd_settime 两次系统调用，可以在任意线程调用
+     */
+    void setUseTimerfd(bool on);
     // ---------------- 定时器相关 --------------------
 
 private:
 
     void handleRead();
-    void doPendingFunctors();                               // 执行上层的回调函数
+    size_t doPendingFunctors();                             // 执行上层的回调函数，返回执行的个数
 
     using ChannelList = std::vector<Channel*>;
 
@@ -74,7 +123,10 @@ private:
 
     const pid_t threadId_;                                  // 记录当前 loop 所在线程的 id
 
+    BufferPool bufferPool_;                                 // 本线程的缓冲区内存池，最后析构
+
     Timestamp pollReturnTime_;                              // poller 返回发生事件的 channels 的时间点
+    Timestamp loopTime_;                                    // 同一时刻的单调时钟
     std::unique_ptr<Poller> poller_;                        // EventLoop 所管理的 Poller，而 poller 帮 EventLoop 监听所有发生事件
 
     std::unique_ptr<TimerQueue> timerQueue_;                // 定时器管理对象
@@ -85,8 +137,14 @@ private:
     ChannelList activeChannels_;                            // 返回 Poller 监听到的有具体事件发生的 fd(Channel)
 
     std::atomic_bool callingPendingFunctors_;               // 标识当前 loop 是否需要执行的回调操作
-    std::vector<Functor> pendingFunctors_;                  // 存储 loop 需要执行的所有的回调操作
-    std::mutex mutex_;                                      // 互斥锁用来保证上 vec 容器的安全操作
+    MpscQueue<Functor> pendingFunctors_;                    // 存储 loop 需要执行的所有的回调操作 (无锁多生产者队列)
+    std::vector<Functor> runningFunctors_;                  // 本轮取出待执行的回调，复用容量避免每轮分配
+    std::atomic_bool wakeupPending_;                        // 已经写过 wakeupFd_ 且 loop 还没开始处理，后续唤醒可以省掉
+    std::atomic<uint64_t> wakeupsIssued_;                   // 实际写 eventfd 的次数
+    std::atomic<uint64_t> wakeupsSuppressed_;               // 被合并掉的唤醒次数
+
+    int64_t busyPollMicros_;                                // 忙轮询窗口 (微秒)，0 表示关闭
+    int64_t lastActiveMicros_;                              // 最近一次有事件或回调的时间 (单调时钟，微秒)
 
 
 };
\ No newline at end of file
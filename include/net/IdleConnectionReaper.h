@@ -0,0 +1,60 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "noncopyable.h"
+#include "TimerId.h"
+
+class EventLoop;
+class TcpConnection;
+
+/**
+ * 空闲连接回收，每个 subloop 一个，只在所属 loop 线程中使用
+ *
+ * 时间轴被分成 buckets + 1 个格子组成的环，每格 idleSeconds / buckets 秒，连接记录在最近一次活跃时所在的格子里:
+ *   touch:  连接已经在当前格子里时只比较一个整数；否则从原来的格子移到当前格子，每格最多移动一次
+ *   每一格: 当前格子前进一格，新的当前格子里的连接已经空闲了 [idleSeconds, idleSeconds + 一格] 秒，整格取出全部强制关闭
+ * 格子里只保存 weak_ptr，已经销毁的连接扫到时直接跳过
+ */
+class IdleConnectionReaper : noncopyable, public std::enable_shared_from_this<IdleConnectionReaper>
+{
+public:
+    static const int kDefaultBuckets = 8;
+
+    IdleConnectionReaper(EventLoop *loop, double idleSeconds, int buckets = kDefaultBuckets);
+
+    // 启动 / 停止每一格的定时器 (在 loop 线程中调用)
+    void start();
+    void stop();
+
+    // 以下函数只在 loop 线程中由 TcpConnection 调用，bucket 是连接自己保存的格子下标 (-1 表示不在环中)
+    void add(const std::shared_ptr<TcpConnection>& conn, int *bucket);
+    void touch(TcpConnection *conn, int *bucket)
+    {
+        if (*bucket != current_)
+        {
+            moveToCurrent(conn, bucket);
+        }
+    }
+    void remove(TcpConnection *conn, int *bucket);
+
+    double idleSeconds() const { return idleSeconds_; }
+
+private:
+    // 以裸指针为键，同一地址上的新连接覆盖旧的 (已经销毁的) 记录
+    using Bucket = std::unordered_map<TcpConnection*, std::weak_ptr<TcpConnection>>;
+
+    void moveToCurrent(TcpConnection *conn, int *bucket);
+    void onTick();
+    static void tickTimeout(const std::weak_ptr<IdleConnectionReaper>& weakReaper);
+
+    EventLoop *loop_;
+    const double idleSeconds_;                                          // 空闲多久后关闭连接
+    const double tickSeconds_;                                          // 每一格的时长
+    std::vector<Bucket> buckets_;                                       // 格子组成的环
+    int current_;                                                       // 当前格子，touch 把连接放到这里
+    TimerId tickTimer_;                                                 // 每一格的定时器
+    Bucket sweeping_;                                                   // 本次扫描取出的格子，复用容量
+};
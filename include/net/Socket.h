@@ -24,6 +24,9 @@ public:
     void setReusePort(bool on);
     void setKeepAlive(bool on);
 
+    // 开启 SO_ZEROCOPY，内核不支持时返回 false
+    bool setZeroCopy(bool on);
+
 
 private:
     const int sockfd_;
@@ -2,18 +2,24 @@
 
 #include <memory>
 #include <string>
+#include <vector>
+#include <deque>
 #include <atomic>
+#include <sys/types.h>
 
 #include "noncopyable.h"
 #include "InetAddress.h"
 #include "Callbacks.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
 #include "Timestamp.h"
+#include "Slice.h"
 
-
+struct iovec;
 class Channel;
 class EventLoop;
 class Socket;
+class IdleConnectionReaper;
 
 /**
  * TcpServer  =>  Acceptor  =>  有一个新用户连接，通过 accrpt 函数拿到 connfd
@@ -22,6 +28,10 @@ class Socket;
 class TcpConnection : noncopyable, public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    static const size_t kDefaultMaxRetainedBytes = 64 * 1024;          // 空闲时输入缓冲区允许保留的容量
+    static const size_t kDefaultZeroCopyThreshold = 256 * 1024;        // 默认的零拷贝发送阈值
+    static const size_t kDefaultHighWaterMark = 64 * 1024 * 1024;      // 默认的输出队列高水位 (64M)
+    static const size_t kDefaultEdgeReadBudget = 256 * 1024;           // 边缘触发下每次读事件最多读取的字节数
 
     TcpConnection(EventLoop *loop, 
                   const std::string &name, 
@@ -37,14 +47,64 @@ public:
 
     bool connected() const { return state_ == kConnected; }
 
+    // 输出队列中还没发出的字节数 (outputBuffer_ 加上文件段 / 零拷贝段的剩余部分)，只在 loop 线程中有意义
+    size_t pendingOutputBytes() const { return outputBuffer_.readableBytes() + segmentBytes_; }
+
+    /**
+     * 暂停 / 恢复从对端读取数据 (线程安全，实际操作在 loop 线程中执行)
+     * 暂停期间对端的数据堆积在内核接收缓冲区里，TCP 流控会让对端慢下来
+     */
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
     // 发送数据
     void send(const std::string &buf);
 
     void send1(Buffer *buf);
 
+    /**
+     * 转移所有权的发送: 在其他线程调用时，数据直接移动进投递给 loop 的回调中，全程没有拷贝
+     * 工作线程可以把构造好的大块响应安全地交给 IO 线程，调用返回后 message / buf 为空
+     */
+    void send(std::string&& message);
+    void send(Buffer&& buf);
+
+    /**
+     * 零拷贝发送 (SO_ZEROCOPY + MSG_ZEROCOPY)，需在 loop 线程中调用 (例如连接建立回调中)
+     * 只作用于转移了所有权、且不小于 threshold 字节的 send(std::string&&) / send(Buffer&&)：
+     * 内核直接引用用户页面发送，数据由连接持有，直到从错误队列读到对应的完成通知才释放
+     * 小数据用零拷贝反而更慢 (需要锁页和处理通知)，所以阈值默认 256K
+     * 内核不支持时返回 false，继续使用普通的拷贝发送
+     */
+    bool setZeroCopy(bool on, size_t threshold = kDefaultZeroCopyThreshold);
+    bool zeroCopy() const { return zeroCopy_; }
+
+    // 已完成的零拷贝发送中，内核实际退化为拷贝的次数 (例如 loopback 上总会退化)
+    uint64_t zeroCopyCopied() const { return zeroCopyCopied_; }
+
+    /**
+     * 通过 sendfile(2) 发送文件 fd 中 [offset, offset + len) 的内容，文件数据不经过用户态
+     * 内部会 dup 一份 fd，调用方在返回后即可关闭自己的 fd
+     * 文件段与普通 send 的数据共用一个输出队列，严格按调用顺序发出
+     * sendfile 出现 EAGAIN 以外的错误 (例如 fd 不支持 sendfile、读文件出错) 时放弃该文件并关闭连接
+     */
+    void sendFile(int fd, off_t offset, size_t len);
+
+    /**
+     * 分散写: 把多段不连续的内存一次发出 (例如 响应头 + 响应体)
+     * 在 loop 线程中调用时先直接 writev，只有内核没有收下的尾部才拷贝进 outputBuffer_；
+     * 在其他线程调用时需要先拷贝一份，再转到 loop 线程发送
+     */
+    void send(const struct iovec* iov, int iovcnt);
+    void send(const std::vector<Slice>& slices);
+
     // 关闭连接
     void shutdown();
 
+    // 不等对端，直接关闭连接 (线程安全)，用于回收空闲连接 / 丢弃异常的对端
+    void forceClose();
+
     void setConnectionCallback(const ConnectionCallback& cb)
     {
         connectionCallback_ = cb;
@@ -60,16 +120,60 @@ public:
         writeCompleteCallback_ = cb;
     }
 
+    /**
+     * 输出队列水位回调，用于背压 (例如代理: 下游连接超过高水位时 stopRead 上游，回落到低水位时 startRead)
+     *  - 输出队列从高水位以下增长到 >= highWaterMark 时回调一次 highWaterMarkCallback_
+     *  - 之后队列排空到 <= lowWaterMark 时回调一次 lowWaterMarkCallback_，并重新武装高水位回调
+     */
     void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
     { 
         highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark;
     }
 
+    void setLowWaterMarkCallback(const LowWaterMarkCallback& cb, size_t lowWaterMark)
+    {
+        lowWaterMarkCallback_ = cb; lowWaterMark_ = lowWaterMark;
+    }
+
     void setCloseCallback(const CloseCallback& cb)
     { 
         closeCallback_ = cb; 
     }
 
+    /**
+     * 输入缓冲区收缩策略 (需在 connectEstablished 之前设置)
+     *  - 每次消息处理完后，若容量超过 maxRetainedBytes 且剩余数据不到容量的 1/4，立即收缩
+     *  - 连接空闲 idleSeconds 秒后，由所属 loop 的定时器把输入缓冲区收缩到实际数据大小
+     * idleSeconds <= 0 表示不启用收缩策略 (默认)，两种收缩都不做
+     */
+    void setBufferShrinkPolicy(double idleSeconds, size_t maxRetainedBytes = kDefaultMaxRetainedBytes)
+    {
+        shrinkIdleSeconds_ = idleSeconds;
+        maxRetainedBytes_ = maxRetainedBytes;
+    }
+
+    /**
+     * 边缘触发模式 (需在 connectEstablished 之前设置，TcpServer::setEdgeTriggered 会为每个新连接设置)
+     *  - 读写事件在连接建立时一次注册 (EPOLLIN | EPOLLOUT | EPOLLET)，之后收发数据不再 epoll_ctl
+     *  - 读事件一直读到 EAGAIN 再回调一次 onMessage，流水线请求可以一次处理完；
+     *    每次最多读 readBudget 字节，超出的部分排到本轮其他连接之后继续读，保证同一 loop 上的公平
+     *  - 写事件把输出队列写到 EAGAIN 为止，输出队列为空时的 EPOLLOUT 直接忽略
+     *  - Poller 后端不支持边缘触发时 (poll)，连接建立时退回水平触发
+     */
+    void setEdgeTriggered(bool on, size_t readBudget = kDefaultEdgeReadBudget)
+    {
+        edgeTriggered_ = on;
+        edgeReadBudget_ = readBudget;
+    }
+
+    /**
+     * 空闲连接回收 (需在 connectEstablished 之前设置，TcpServer::setIdleTimeout 会为每个新连接设置)
+     * 连接建立时加入所属 loop 的回收环，每次读到数据或者输出队列有发送进展时 touch 一次，
+     * 超时既没有收到数据、也没有发出数据的连接被 forceClose
+     */
+    void setIdleReaper(const std::shared_ptr<IdleConnectionReaper>& reaper) { idleReaper_ = reaper; }
+    bool edgeTriggered() const { return edgeTriggered_; }
+
     // 连接建立
     void connectEstablished();
 
@@ -88,14 +192,67 @@ private:
     //
     void setState(StateE state) { state_ = state; } 
 
+    /**
+     * 输出队列中不经过 outputBuffer_ 的段
+     *   文件段:   fd >= 0，用 sendfile 发送
+     *   零拷贝段: fd == -1，用 MSG_ZEROCOPY 直接发送 payload 持有的内存
+     */
+    struct OutputSegment
+    {
+        int fd;                         // dup 得到的文件描述符，发送完毕后关闭
+        off_t offset;                   // 下一次发送的起始偏移 (文件偏移 / data 内的偏移)
+        size_t remaining;               // 剩余待发送的字节数
+        size_t bytesBefore;             // outputBuffer_ 中排在该段之前 (且在上一段之后) 的字节数
+        const char* data;               // 零拷贝段的数据
+        std::shared_ptr<void> payload;  // 零拷贝段数据的所有者 (std::string / Buffer)
+    };
+
     void handleRead(Timestamp receiveTime);
     void handleWrite();
     void handleClose();
     void handleError();
 
+    // 边缘触发下读预算用完后，在本轮末尾接着读
+    void resumeEdgeRead(Timestamp receiveTime);
+
+    // 输出队列是否在等待 EPOLLOUT 继续发送 (此时新数据只能排队，不能直接写)
+    bool isWaitingWritable() const;
+
+    // 空闲收缩定时器
+    void scheduleIdleShrink(Timestamp when);
+    void handleIdleShrink();
+    static void idleShrinkTimeout(const std::weak_ptr<TcpConnection>& weakConn);
+
     void sendInLoop(const void* message, size_t len);
+    void sendvInLoop(const struct iovec* iov, int iovcnt);
     void sendInLoop1(const std::string& message);
+    void sendBufferInLoop(const std::shared_ptr<Buffer>& buf);
+    void sendFileInLoop(int fd, off_t offset, size_t len);
+    void startReadInLoop();
+    void stopReadInLoop();
+
+    // 输出队列增长后检查高水位，排空后检查低水位
+    void checkHighWaterMark();
+    void checkLowWaterMark();
+    void sendStringInLoop(const std::shared_ptr<std::string>& message);
+    void sendOwnedInLoop(const std::shared_ptr<void>& payload, const char* data, size_t len);
+
+    // 把一个段排进输出队列，它之前的是 outputBuffer_ 中还没有被其他段认领的字节
+    void appendSegment(OutputSegment& seg);
+
+    // 是否应当走零拷贝发送
+    bool useZeroCopy(size_t len) const { return zeroCopy_ && len >= zeroCopyThreshold_; }
+
+    // 读取错误队列中的零拷贝完成通知并释放对应的数据，读到任何通知返回 true
+    bool handleZeroCopyCompletions();
+
+    // 输出队列中是否还有没发完的数据 (缓冲区或其他段)
+    bool hasPendingOutput() const { return outputBuffer_.readableBytes() > 0 || !segments_.empty(); }
+
+    // 按顺序发送输出队列，直到全部发完或内核发送缓冲区写满，出错返回 false (调用方应关闭连接，出错的文件段已被丢弃)
+    bool flushOutput(int* savedErrno);
     void shutdownInLoop();
+    void forceCloseInLoop();
 
     // 这里绝对不是 baseloop, 因为 TcpConnetion 都是在 subloop 里面管理的
     EventLoop *loop_;
@@ -117,13 +274,39 @@ private:
     ConnectionCallback connectionCallback_;                             // 新连接回调
     MessageCallback messageCallback_;                                   // 读写消息的回调
     WriteCompleteCallback writeCompleteCallback_;                       // 消息发送时的回调
-    HighWaterMarkCallback highWaterMarkCallback_;                       // 水位线回调？？？
+    HighWaterMarkCallback highWaterMarkCallback_;                       // 输出队列超过高水位的回调
+    LowWaterMarkCallback lowWaterMarkCallback_;                         // 输出队列回落到低水位的回调
     CloseCallback closeCallback_;                                       // 关闭连接回调
 
-    size_t highWaterMark_;                                              // 警告水位线
+    size_t highWaterMark_;                                              // 高水位线
+    size_t lowWaterMark_;                                               // 低水位线
+    bool aboveHighWaterMark_;                                           // 已越过高水位，尚未回落到低水位
+
+    double shrinkIdleSeconds_;                                          // 空闲多久后收缩输入缓冲区
+    size_t maxRetainedBytes_;                                           // 输入缓冲区常驻容量上限
+    Timestamp lastActiveTime_;                                          // 最近一次读到数据的时间 (loop 的单调时钟)
+    bool shrinkTimerPending_;                                           // 是否已有收缩定时器在排队
 
     // 数据缓冲区
     Buffer inputBuffer_;                                                // 接受数据的缓冲区
-    Buffer outputBuffer_;                                               // 发送数据的缓冲区
+    ChainBuffer outputBuffer_;                                          // 发送数据的缓冲区 (链式，handleWrite 时 writev 一次发出)
+    std::deque<OutputSegment> segments_;                                // 排队中的文件段 / 零拷贝段，与 outputBuffer_ 交错组成输出队列
+    size_t bytesBeforeSegments_;                                        // 所有段 bytesBefore 之和
+    size_t segmentBytes_;                                               // 所有段剩余待发送的字节数之和
+
+    // 零拷贝发送
+    bool zeroCopy_;                                                     // 是否开启零拷贝
+    size_t zeroCopyThreshold_;                                          // 不小于该字节数的数据才走零拷贝
+    uint32_t zeroCopyNextSeq_;                                          // 下一次 MSG_ZEROCOPY 调用的完成序号
+    std::deque<std::pair<uint32_t, std::shared_ptr<void>>> zeroCopyPinned_; // 等待完成通知的数据 (按序号递增)
+    uint64_t zeroCopyCopied_;                                           // 内核退化为拷贝的次数
+
+    // 边缘触发
+    bool edgeTriggered_;                                                // 是否以边缘触发方式注册
+    size_t edgeReadBudget_;                                             // 每次读事件最多读取的字节数
+
+    // 空闲连接回收
+    std::shared_ptr<IdleConnectionReaper> idleReaper_;                  // 所属 loop 的回收环，为空表示不回收
+    int idleBucket_;                                                    // 所在的格子，-1 表示不在环中
 
 };
\ No newline at end of file
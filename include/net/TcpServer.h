@@ -13,6 +13,7 @@
 #include "EventLoopThreadPool.h"
 #include "Callbacks.h"
 #include "TcpConnection.h"
+#include "IdleConnectionReaper.h"
 #include "Buffer.h"
 
 // 对外服务器编程使用的类
@@ -35,6 +36,42 @@ public:
     void setMessagecallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompletecallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
 
+    // 新连接的输出队列水位回调，见 TcpConnection::setHighWaterMarkCallback
+    void setHighWaterMarkcallback(const HighWaterMarkCallback &cb, size_t highWaterMark)
+    {
+        highWaterMarkCallback_ = cb;
+        highWaterMark_ = highWaterMark;
+    }
+    void setLowWaterMarkcallback(const LowWaterMarkCallback &cb, size_t lowWaterMark)
+    {
+        lowWaterMarkCallback_ = cb;
+        lowWaterMark_ = lowWaterMark;
+    }
+
+    // 新连接的输入缓冲区收缩策略，见 TcpConnection::setBufferShrinkPolicy
+    void setBufferShrinkPolicy(double idleSeconds, size_t maxRetainedBytes = TcpConnection::kDefaultMaxRetainedBytes)
+    {
+        shrinkIdleSeconds_ = idleSeconds;
+        maxRetainedBytes_ = maxRetainedBytes;
+    }
+
+    // 新连接使用边缘触发，见 TcpConnection::setEdgeTriggered
+    void setEdgeTriggered(bool on, size_t readBudget = TcpConnection::kDefaultEdgeReadBudget)
+    {
+        edgeTriggered_ = on;
+        edgeReadBudget_ = readBudget;
+    }
+
+    /**
+     * 关闭空闲超过 idleSeconds 秒 (既没有收到数据，发送也没有进展) 的连接 (需在 start 之前设置，<= 0 表示不回收)
+     * 每个 subloop 一个回收环，精度为 idleSeconds / buckets，连接实际在空闲 [idleSeconds, idleSeconds + 一格] 秒后关闭
+     */
+    void setIdleTimeout(double idleSeconds, int buckets = IdleConnectionReaper::kDefaultBuckets)
+    {
+        idleSeconds_ = idleSeconds;
+        idleBuckets_ = buckets;
+    }
+
     // 提供给Http用
     EventLoop* getLoop() const { return loop_; }
     const std::string name() { return name_; }
@@ -53,6 +90,7 @@ private:
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using ReaperMap = std::unordered_map<EventLoop*, std::shared_ptr<IdleConnectionReaper>>;
 
     EventLoop *loop_;
     const std::string ipPort_;
@@ -64,8 +102,20 @@ private:
     ConnectionCallback connectionCallback_;                             // 新连接回调
     MessageCallback messageCallback_;                                   // 读写消息的回调
     WriteCompleteCallback writeCompleteCallback_;                       // 消息发送时的回调
+    HighWaterMarkCallback highWaterMarkCallback_;                       // 输出队列超过高水位的回调
+    LowWaterMarkCallback lowWaterMarkCallback_;                         // 输出队列回落到低水位的回调
+    size_t highWaterMark_;                                              // 高水位线
+    size_t lowWaterMark_;                                               // 低水位线
 
     ThreadInitCallback threadInitCallback_;                             // loop 线程初始化的回调
+
+    double shrinkIdleSeconds_;                                          // 连接空闲多久后收缩输入缓冲区
+    size_t maxRetainedBytes_;                                           // 输入缓冲区常驻容量上限
+    bool edgeTriggered_;                                                // 新连接是否使用边缘触发
+    size_t edgeReadBudget_;                                             // 边缘触发下每次读事件的读取预算
+    double idleSeconds_;                                                // 连接空闲多久后关闭
+    int idleBuckets_;                                                   // 空闲回收环的格数
+    ReaperMap idleReapers_;                                             // 每个 subloop 的空闲回收环
     std::atomic_int started_;
 
     int nextConnId_;
@@ -30,6 +30,12 @@ private:
     // 填写活跃的连接
     void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
 
+    // 提交本轮积累的关注事件修改
+    void applyPendingChanges();
+
+    // channel 关注的事件对应的 epoll 事件 (边缘触发时带上 EPOLLET)
+    static uint32_t epollEvents(Channel *channel);
+
     // 更新 channel 通道
     void update(int operation, Channel *channel);
 
@@ -37,4 +43,5 @@ private:
     
     int epollfd_;               // epoll 对应的 listenfd
     EventList events_;          // 存储对应 epoll 上注册的 fd
+    std::vector<Channel*> pendingChanges_;  // 关注事件有修改、等待下一次 epoll_wait 前提交的 channel
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Poller.h"
+
+class Channel;
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * 基于 io_uring 的 IO 复用，只用 IORING_OP_POLL_ADD 做就绪通知，收发数据仍由 TcpConnection 的 read / write 完成
+ *  - 关注事件的修改 (POLL_ADD / POLL_REMOVE) 写进提交队列，与等待合并成一次 io_uring_enter 系统调用
+ *  - 水平触发的 channel 使用一次性 poll，事件分发后在下一次等待之前重新提交 (提交时仍然就绪会立即完成)，语义与 epoll LT 相同
+ *  - 边缘触发的 channel 使用 multishot poll，提交一次持续有效
+ * 直接使用系统调用，不依赖 liburing；内核不支持时 newDefaultPoller 退回 EPollPoller
+ *
+ * 注意: 目前并没有减少每个请求的系统调用，不要为了性能选用它
+ *  - 水平触发的 channel 每次事件之后都要重新提交 POLL_ADD，bench_poller 中 10 万次接力 ctl=100011，epoll 只有 12
+ *  - 收发数据和 accept 仍然是普通的 read / write / accept 系统调用，基于完成事件的 recv / send / accept 还没有实现
+ * 现阶段它只是作为一致性对照和后续工作的基础
+ */
+class IoUringPoller : public Poller
+{
+public:
+    // 内核不支持 io_uring (或缺少需要的特性) 时返回 nullptr
+    static IoUringPoller* create(EventLoop *loop);
+    ~IoUringPoller() override;
+
+    // 重写抽象方法
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+private:
+    static const unsigned kRingEntries = 256;
+
+    /**
+     * 每个 fd 的注册状态，按 fd 下标存放
+     * 提交给内核的 user_data = (generation << 32) | fd，注销或修改关注事件时 generation 加一，
+     * 旧请求迟到的完成事件 (包括被取消的) 据此丢弃，fd 被关闭后复用也不会串到新的 channel 上
+     */
+    struct Registration
+    {
+        Channel *channel;
+        uint32_t generation;
+        uint32_t events;            // 内核中挂起的 poll 请求关注的事件 (含 EPOLLET)，0 表示没有
+        int revents;                // 本轮收集到的就绪事件
+    };
+
+    explicit IoUringPoller(EventLoop *loop);
+    bool setup();
+
+    Registration& registration(int fd);
+
+    // 提交本轮积累的关注事件修改，以及需要重新提交的一次性 poll
+    void applyPendingChanges();
+    void scheduleUpdate(Channel *channel);
+
+    void submitPollAdd(int fd, const Registration& reg);
+    void submitPollRemove(int fd, const Registration& reg);
+    io_uring_sqe* getSqe();
+
+    // 收割完成队列，填写活跃的连接
+    int reapCompletions(ChannelList *activeChannels);
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize);
+
+    int ringFd_;
+
+    // 提交队列 (与内核共享的环)
+    void *sqRing_;
+    size_t sqRingSize_;
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned *sqArray_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+    unsigned sqLocalTail_;          // 已填写的 SQE 的尾部
+    unsigned toSubmit_;             // 已填写但还没有提交给内核的 SQE 个数
+
+    // 完成队列
+    void *cqRing_;                  // 内核支持单次映射时与 sqRing_ 相同
+    size_t cqRingSize_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    std::vector<Registration> registrations_;
+    std::vector<Channel*> pendingChanges_;      // 关注事件有修改、或一次性 poll 已经完成需要重新提交的 channel
+    std::vector<int> readyFds_;                 // 本轮有就绪事件的 fd
+};
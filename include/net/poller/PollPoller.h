@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "Poller.h"
+
+struct pollfd;
+
+/**
+ * poll(2) 的实现，用于没有 epoll 的环境以及作为其他后端的对照
+ *  - pollfds_ 与 channel 一一对应，channel 的 index 即它在 pollfds_ 中的下标
+ *  - 注销时把最后一个元素换到空出的位置，注册 / 修改 / 注销都是 O(1)
+ *  - 不关注任何事件的 channel 把 fd 取反 (-fd - 1)，poll 会忽略负的 fd
+ *  - 只有水平触发，channel 的边缘触发设置被忽略；TcpConnection 据 supportsEdgeTriggered 退回水平触发，
+ *    否则常驻的 POLLOUT 会让 poll 每次立即返回
+ */
+class PollPoller : public Poller
+{
+public:
+    PollPoller(EventLoop *loop);
+    ~PollPoller() override;
+
+    // 重写抽象方法
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+    bool supportsEdgeTriggered() const override { return false; }
+
+private:
+    // 填写活跃的连接
+    void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
+
+    using PollFdList = std::vector<struct pollfd>;
+    PollFdList pollfds_;
+};
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
+#include <atomic>
+#include <stdint.h>
 
 #include "noncopyable.h"
 #include "Timestamp.h"
@@ -24,19 +25,73 @@ public:
     virtual void updateChannel(Channel *channel) = 0;
     virtual void removeChannel(Channel *channel) = 0;
 
+    // 是否支持边缘触发，不支持时 channel 的边缘触发设置被忽略 (只能按水平触发使用)
+    virtual bool supportsEdgeTriggered() const { return true; }
+
     // 判断参数 channel 是否在当前 Poller 中
     bool hashChannel(Channel *channel) const;
 
     // EventLoop 事件循环可以通过该接口获取默认的 IO 复用的具体实现
     static Poller* newDefaultPoller(EventLoop *loop);
 
+    // 统计: 等待调用次数 / 返回的就绪事件总数 / 修改关注事件的系统调用次数 (epoll_ctl 等)
+    uint64_t pollCalls() const { return pollCalls_.load(std::memory_order_relaxed); }
+    uint64_t pollEvents() const { return pollEvents_.load(std::memory_order_relaxed); }
+    uint64_t ctlCalls() const { return ctlCalls_.load(std::memory_order_relaxed); }
+
 
 protected:
-    // map 存储的为             key -> sockfd   value -> 所属的channel通道类型
-    using ChannelMap = std::unordered_map<int, Channel*>;
-    ChannelMap channels_;
+    /**
+     * fd 是小而稠密的整数，channel 表直接以 fd 为下标 (按需扩容，空位为 nullptr)
+     * 注册 / 注销 / 查找都是一次数组访问，不需要哈希，10 万个连接也只占 800K 内存
+     */
+    using ChannelTable = std::vector<Channel*>;
+    ChannelTable channels_;
+    size_t numChannels_;                        // 表中非空的项数
+
+    void setChannel(int fd, Channel *channel)
+    {
+        if (static_cast<size_t>(fd) >= channels_.size())
+        {
+            channels_.resize(fd + 1, nullptr);  // vector 按倍数扩容，均摊 O(1)
+        }
+        if (channels_[fd] == nullptr)
+        {
+            ++numChannels_;
+        }
+        channels_[fd] = channel;
+    }
+
+    void eraseChannel(int fd)
+    {
+        if (static_cast<size_t>(fd) < channels_.size() && channels_[fd] != nullptr)
+        {
+            channels_[fd] = nullptr;
+            --numChannels_;
+        }
+    }
+
+    Channel* findChannel(int fd) const
+    {
+        return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+    }
+
+    // 只在 loop 线程中递增，原子变量只是为了让其他线程可以读取
+    void countPoll(int numEvents)
+    {
+        pollCalls_.fetch_add(1, std::memory_order_relaxed);
+        if (numEvents > 0)
+        {
+            pollEvents_.fetch_add(numEvents, std::memory_order_relaxed);
+        }
+    }
+    void countCtl() { ctlCalls_.fetch_add(1, std::memory_order_relaxed); }
 
 private:
     EventLoop *ownerLoop_;       // 定义 Poller 所属的事件循环 EventLoop
+
+    std::atomic<uint64_t> pollCalls_;
+    std::atomic<uint64_t> pollEvents_;
+    std::atomic<uint64_t> ctlCalls_;
 };
 
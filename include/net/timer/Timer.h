@@ -1,40 +1,101 @@
 #pragma once
 
 #include <functional>
+#include <stdint.h>
 
 #include "noncopyable.h"
 #include "Timestamp.h"
+#include "InlineFunction.h"
 
 /**
  * Timer 用于描述一个定时器
  * 定时器回调函数，下一次超时时刻，重复定时器的时间间隔等
+ *
+ * 定时器对象由 TimerQueue 复用: 结束后释放回调、序号清零放入空闲链表，下次 addTimer 重新初始化
+ * TimerId 中记录的序号与当前序号不同，说明句柄对应的定时器已经结束
  */
 class Timer : noncopyable
 {
 public:
-    using TimerCallback = std::function<void()>;
-
-    Timer(TimerCallback cb, Timestamp when, double interval)
-        : callback_(move(cb)),
-          expiration_(when),
-          interval_(interval),
-          repeat_(interval > 0.0) // 一次性定时器设置为0
-    {}
-
-    void run() const 
-    { 
-        callback_(); 
+    using TimerCallback = InlineFunction<void()>;
+
+    Timer(TimerCallback cb, Timestamp when, double interval, int64_t sequence)
+        : wheelPrev_(nullptr),
+          wheelNext_(nullptr),
+          wheelSlot_(-1)
+    {
+        reinit(std::move(cb), when, interval, sequence);
+    }
+
+    // 从空闲链表中取出复用时重新初始化
+    void reinit(TimerCallback cb, Timestamp when, double interval, int64_t sequence)
+    {
+        callback_ = std::move(cb);
+        expiration_ = when;
+        deadline_ = when;
+        interval_ = interval;
+        repeat_ = interval > 0.0;   // 一次性定时器设置为0
+        sequence_ = sequence;
+        queued_ = false;
+        canceled_ = false;
+    }
+
+    // 放回空闲链表之前调用，回调捕获的对象 (例如连接的 shared_ptr) 随之释放
+    void release()
+    {
+        callback_ = nullptr;
+        sequence_ = 0;
+    }
+
+    void run() const
+    {
+        callback_();
     }
 
     Timestamp expiration() const  { return expiration_; }
     bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    /**
+     * 期望的到期时间，推迟 (reset 到更晚的时刻) 时只修改它，不动存储结构中的位置，
+     * 到了 expiration() 再按 deadline() 重新插入，频繁推迟的超时定时器每个周期只重新插入一次
+     * 执行回调前清空，回调中再次 reset 会重新设置，TimerQueue 据此判断是否需要重新插入
+     */
+    Timestamp deadline() const { return deadline_; }
+    void setDeadline(Timestamp when) { deadline_ = when; }
+    void clearDeadline() { deadline_ = Timestamp::invalid(); }
+
+    // 按 deadline() 或者指定时刻重新设置存储结构中使用的到期时间 (不在存储结构中时调用)
+    void moveTo(Timestamp when)
+    {
+        expiration_ = when;
+        deadline_ = when;
+    }
+
+    // 是否在存储结构中 (false 表示正处于本轮到期的定时器中)
+    bool queued() const { return queued_; }
+    void setQueued(bool on) { queued_ = on; }
+
+    // 在执行本轮到期回调期间被取消，由 TimerQueue 在回调结束后回收
+    bool canceled() const { return canceled_; }
+    void cancel() { canceled_ = true; }
 
     // 重启定时器(如果是非重复事件则到期时间置为0)
     void restart(Timestamp now);
 
 private:
-    const TimerCallback callback_;                              // 定时器回调函数
-    Timestamp expiration_;                                      // 下一次的超时时刻
-    const double interval_;                                     // 超时时间间隔，如果是一次性定时器，该值为0
-    const bool repeat_;                                         // 是否重复(false 表示是一次性定时器)
+    TimerCallback callback_;                                    // 定时器回调函数
+    Timestamp expiration_;                                      // 存储结构中使用的超时时刻
+    Timestamp deadline_;                                        // 期望的超时时刻，不早于 expiration_
+    double interval_;                                           // 超时时间间隔，如果是一次性定时器，该值为0
+    bool repeat_;                                               // 是否重复(false 表示是一次性定时器)
+    int64_t sequence_;                                          // 序号，0 表示在空闲链表中
+    bool queued_;                                               // 是否在存储结构中
+    bool canceled_;                                             // 执行回调期间被取消
+
+    // 时间轮槽位链表 (侵入式，挂入 / 摘除不需要额外分配)，红黑树实现不使用
+    friend class TimerWheel;
+    Timer *wheelPrev_;
+    Timer *wheelNext_;
+    int wheelSlot_;                                             // 所在的槽位，-1 表示不在时间轮中
 };
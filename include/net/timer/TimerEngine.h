@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+class Timer;
+
+/**
+ * 定时器的存储结构，TimerQueue 通过它管理所有未到期的定时器
+ * timerfd 的设置、到期回调的执行、重复定时器的重新插入都由 TimerQueue 完成，这里只负责按时间组织 Timer
+ *  - TimerTree  : 红黑树，精确到微秒，插入 / 删除 O(log n)
+ *  - TimerWheel : 分层时间轮，精度为毫秒，插入 / 删除 / 到期 O(1)
+ * 定时器对象由 TimerQueue 持有，存储结构不负责释放
+ */
+class TimerEngine : noncopyable
+{
+public:
+    virtual ~TimerEngine() = default;
+
+    // 插入定时器，返回 true 表示它比之前最早需要处理的时刻更早 (需要重新设置 timerfd)
+    virtual bool insert(Timer *timer) = 0;
+
+    // 从存储结构中删除定时器 (按插入时的 expiration() 定位)
+    virtual void remove(Timer *timer) = 0;
+
+    // 取出所有在 now 时刻 (含) 之前到期的定时器，追加到 expired 中
+    virtual void getExpired(Timestamp now, std::vector<Timer*> *expired) = 0;
+
+    // 下一次需要处理的时刻，没有定时器时返回 Timestamp::invalid()
+    // (时间轮可能返回比最早的定时器更早的时刻，届时把高层的定时器降到低层)
+    virtual Timestamp nextExpiration() const = 0;
+
+    // 取出全部定时器 (切换存储结构或者析构时使用)
+    virtual void takeAll(std::vector<Timer*> *timers) = 0;
+
+    virtual bool empty() const = 0;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Timestamp.h"
+
+class Timer;
+class TimerQueue;
+
+/**
+ * 定时器句柄，由 EventLoop::runAt / runAfter / runEvery 返回，可以随意拷贝
+ * cancel / reset 可以在任意线程调用，操作投递到所属 loop 中执行
+ * 定时器已经结束 (到期执行完毕或者被取消) 时操作被忽略，定时器对象被复用也不会误操作到新的定时器上
+ * 句柄不能在所属的 EventLoop 析构之后使用
+ */
+class TimerId
+{
+public:
+    TimerId()
+        : queue_(nullptr),
+          timer_(nullptr),
+          sequence_(0)
+    {}
+
+    TimerId(TimerQueue* queue, Timer* timer, int64_t sequence)
+        : queue_(queue),
+          timer_(timer),
+          sequence_(sequence)
+    {}
+
+    // 取消定时器，回调不会再执行
+    void cancel() const;
+
+    // 把到期时间改为 newDeadline (墙上时间，与 EventLoop::runAt 相同；重复定时器之后仍按原来的间隔执行)
+    // 推迟到更晚的时刻是 O(1) 的
+    void reset(Timestamp newDeadline) const;
+
+    // 把到期时间改为 delaySeconds 秒之后，刷新空闲超时用它，只读一次单调时钟
+    void resetAfter(double delaySeconds) const;
+
+    // 是否关联了定时器 (默认构造的句柄为 false，不表示定时器是否已经结束)
+    bool valid() const { return timer_ != nullptr; }
+
+private:
+    TimerQueue* queue_;
+    Timer* timer_;
+    int64_t sequence_;
+};
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <vector>
-#include <set>
+#include <memory>
+#include <atomic>
 
 #include "Timestamp.h"
 #include "Channel.h"
+#include "TimerEngine.h"
+#include "TimerId.h"
 
 class EventLoop;
 class Timer;
@@ -12,46 +15,81 @@ class Timer;
 class TimerQueue
 {
 public:
-    using TimerCallback = std::function<void()>;
+    using TimerCallback = InlineFunction<void()>;
+
+    // 定时器的存储结构
+    enum EngineType
+    {
+        kTimerTree,         // 红黑树 (默认)，微秒精度，插入 O(log n)
+        kTimerWheel,        // 分层时间轮，毫秒精度，插入 / 到期 O(1)，适合大量连接的超时定时器
+    };
 
     explicit TimerQueue(EventLoop* loop);
     ~TimerQueue();
 
-    // 插入定时器（回调函数，到期时间，是否重复）
-    void addTimer(TimerCallback cb, Timestamp when, double interval);
-    
-private:
-    using Entry = std::pair<Timestamp, Timer*>; // 以时间戳作为键值获取定时器
-    using TimerList = std::set<Entry>;          // 底层使用红黑树管理，自动按照时间戳进行排序
+    // 插入定时器（回调函数，到期时间，是否重复），返回可以取消 / 重新设置的句柄 (线程安全)
+    // 到期时间以及下面 reschedule 的时间都是单调时钟 (Timestamp::monotonic())
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+
+    // 由 TimerId 调用 (线程安全)，sequence 与定时器当前的序号不同时忽略
+    void cancel(Timer* timer, int64_t sequence);
+    void reschedule(Timer* timer, int64_t sequence, Timestamp when);
+
+    // 切换存储结构，已有的定时器会迁移到新的结构中 (线程安全)
+    void setEngine(EngineType type);
+
+    // 是否使用 timerfd 唤醒 (默认 true，线程安全)
+    // false 时关闭 timerfd，由 EventLoop 把最早的到期时间并入 poll 的超时，poll 返回后调用 expireTimers，
+    // 省掉一个 fd 以及每次到期的 read / timerfd_settime 两次系统调用，精度为毫秒
+    void setUseTimerfd(bool on);
 
+    // 以下两个函数只在 loop 线程中由 EventLoop 调用，使用 timerfd 时不做任何事
+    // 距离最早的到期时间还有多少毫秒 (向上取整)，不超过 maxMs
+    int pollTimeoutMs(int maxMs) const;
+    // 处理 now 之前到期的定时器
+    void expireTimers(Timestamp now);
+
+private:
     // 由于是在在本 loop 中添加定时器，所以是线程安全的
     void addTimerInLoop(Timer* timer);
+    void cancelInLoop(Timer* timer, int64_t sequence);
+    void rescheduleInLoop(Timer* timer, int64_t sequence, Timestamp when);
+    void setEngineInLoop(EngineType type);
+    void setUseTimerfdInLoop(bool on);
+
+    // 插入存储结构，返回最早到期时间是否改变
+    bool insert(Timer* timer);
+
+    // 定时器对象的分配与回收 (只在 loop 线程中调用)
+    Timer* allocTimer(TimerCallback cb, Timestamp when, double interval, int64_t sequence);
+    void recycleTimer(Timer* timer);
 
     // 定时器读事件触发的函数
     void handleRead();
 
+    // 取出到期的定时器，依次执行回调，重新插入重复的定时器，最后只设置一次唤醒时间
+    void processExpired(Timestamp now);
+
+    // 设置唤醒时间，与当前设置的相同时不做系统调用
+    void arm(Timestamp expiration);
+    // 按最早到期的定时器重新设置唤醒时间
+    void rearm();
+
     // 重新设置 timerfd_
     void resetTimerfd(int timerfd_, Timestamp expiration);
-    
-
-    
-    // 移除所有已到期的定时器
-    // 获取到期的定时器
-    std::vector<Entry> getExpired(Timestamp now);
 
     // 重置这些定时器（销毁或者重复定时任务）
-    void reset(const std::vector<Entry>& expired, Timestamp now);
-
-
-
-    // 插入定时器的内部方法
-    bool insert(Timer* timer);
+    void reset(const std::vector<Timer*>& expired, Timestamp now);
 
     EventLoop* loop_;                                               // 所属的EventLoop
-    const int timerfd_;                                             // timerfd 是 Linux 提供的定时器接口
-    Channel timerfdChannel_;                                        // 封装timerfd_文件描述符
-    
-    TimerList timers_;                                              // 定时器队列（内部实现是红黑树）
+    int timerfd_;                                                   // timerfd 是 Linux 提供的定时器接口，-1 表示定时器并入 poll 超时
+    std::unique_ptr<Channel> timerfdChannel_;                       // 封装timerfd_文件描述符
+    Timestamp armedExpiration_;                                     // 当前设置的唤醒时间，无效表示没有设置
+
+    std::unique_ptr<TimerEngine> timers_;                           // 定时器存储结构（默认是红黑树）
+    std::vector<Timer*> expired_;                                   // 本轮到期的定时器，复用容量避免每次分配
+    std::vector<Timer*> freeTimers_;                                // 空闲的定时器对象，addTimer 优先复用
+    std::atomic<int64_t> nextSequence_;                             // 定时器序号，从 1 开始递增
 
     bool callingExpiredTimers_;                                     // 标明正在获取超时定时器
 };
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <set>
+#include <utility>
+
+#include "TimerEngine.h"
+
+// 红黑树实现的定时器存储结构 (默认)，按到期时间排序，精确到微秒
+class TimerTree : public TimerEngine
+{
+public:
+    TimerTree() = default;
+    ~TimerTree() override = default;
+
+    bool insert(Timer *timer) override;
+    void remove(Timer *timer) override;
+    void getExpired(Timestamp now, std::vector<Timer*> *expired) override;
+    Timestamp nextExpiration() const override;
+    void takeAll(std::vector<Timer*> *timers) override;
+    bool empty() const override { return timers_.empty(); }
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>; // 以时间戳作为键值获取定时器
+    using TimerList = std::set<Entry>;          // 底层使用红黑树管理，自动按照时间戳进行排序
+
+    TimerList timers_;
+};
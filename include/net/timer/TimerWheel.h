@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "TimerEngine.h"
+
+/**
+ * 分层时间轮 (与 Linux 内核早期的 timer wheel 相同的结构)，一个刻度为 1 毫秒
+ *  - 第 0 层 256 个槽，存放 256ms 以内到期的定时器，每个槽对应一个确定的刻度
+ *  - 第 1 ~ 4 层各 64 个槽，每层的跨度是下一层的 64 倍，总共覆盖 2^32 ms (约 49 天)，更远的放在最高层，降层时重新计算
+ *  - 低层转完一圈时，把上一层当前槽中的定时器重新分配到低层 (cascade)
+ * 插入、摘除都是链表操作 O(1)；每层用位图记录非空槽，下一次需要处理的时刻靠位图查找得到，
+ * 推进时直接跳到下一个非空的刻度，空闲期间不需要逐毫秒走过去
+ * 定时器到期时间向上取整到毫秒，不会提前触发，最多晚 1ms
+ */
+class TimerWheel : public TimerEngine
+{
+public:
+    explicit TimerWheel(Timestamp now);
+    ~TimerWheel() override = default;
+
+    bool insert(Timer *timer) override;
+    void remove(Timer *timer) override;
+    void getExpired(Timestamp now, std::vector<Timer*> *expired) override;
+    Timestamp nextExpiration() const override;
+    void takeAll(std::vector<Timer*> *timers) override;
+    bool empty() const override { return size_ == 0; }
+
+private:
+    static const int kLevels = 5;
+    static const int kRootBits = 8;
+    static const int kLevelBits = 6;
+    static const int kRootSlots = 1 << kRootBits;                           // 第 0 层槽数
+    static const int kLevelSlots = 1 << kLevelBits;                         // 第 1 ~ 4 层每层的槽数
+    static const int kNumSlots = kRootSlots + (kLevels - 1) * kLevelSlots;
+    static const int64_t kMaxDelta = (1LL << (kRootBits + (kLevels - 1) * kLevelBits)) - 1;
+    static const int64_t kNoTick = INT64_MAX;
+
+    // 到期时间向上取整得到的刻度 (毫秒)
+    static int64_t tickOf(Timestamp when);
+
+    // 按与 currentTick_ 的距离挂到对应的槽中
+    void place(Timer *timer, int64_t tick);
+    void link(Timer *timer, int slot);
+    void unlink(Timer *timer);
+
+    // 下一个需要处理的刻度 (第 0 层的非空槽，或者高层非空槽的降层时刻)
+    int64_t nextEventTick() const;
+
+    // 走到下一个刻度: 需要时降层，然后取出第 0 层当前槽中的定时器
+    void step(std::vector<Timer*> *expired);
+    void cascade(int level);
+
+    Timer *slots_[kNumSlots];                       // 各槽的链表头，第 0 层在前，之后每层 64 个
+    uint64_t occupied_[kNumSlots / 64];             // 非空槽位图，第 0 层占前 4 个字，第 L 层占第 3 + L 个字
+    int64_t currentTick_;                           // 已经处理到的刻度，不大于它的槽都已经取空
+    int64_t earliestTick_;                          // 已经告知 TimerQueue 的最早处理时刻 (timerfd 不会晚于它)
+    size_t size_;                                   // 时间轮中的定时器个数
+};
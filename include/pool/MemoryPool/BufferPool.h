@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "noncopyable.h"
+
+/**
+ * 缓冲区内存池 (one pool per loop)
+ *
+ * 每个 EventLoop 持有一个 BufferPool，构造时登记为所在线程的 "当前内存池"。
+ * Buffer / ChainBuffer 的存储都通过 BufferPool::alloc / BufferPool::release 申请与归还：
+ *   - 按 2 的幂划分 size class (1K ~ 128K)，每个 class 维护一条空闲链表
+ *   - 连接销毁时内存回到本线程的空闲链表，下一个连接直接复用，避免 malloc/free 抖动
+ *   - 超出最大 size class 的请求，或者线程中没有 EventLoop 时，直接走 operator new/delete
+ *
+ * 由于每块内存都是按 size class 大小单独 new 出来的，不同线程的 pool 之间可以安全地互相归还，
+ * 因此即使 Buffer 在别的线程析构也不会出错，只是那块内存会进入别的线程的 pool。
+ * 整个类只在所属线程中使用，不加锁。
+ */
+class BufferPool : noncopyable
+{
+public:
+    static const int kNumSizeClasses = 8;                                       // 1K 2K 4K ... 128K
+    static const size_t kMinBlockSize = 1024;                                   // 最小的 size class
+    static const size_t kMaxBlockSize = kMinBlockSize << (kNumSizeClasses - 1); // 最大的 size class
+    static const size_t kDefaultMaxCachedBytes = 2 * 1024 * 1024;               // 每个 size class 最多缓存的字节数
+    static const size_t kSpillBufferSize = 64 * 1024;                           // readv 溢出区大小
+
+    BufferPool();
+    ~BufferPool();
+
+    // 分配至少 size 字节，实际分配的大小写入 *actualSize (为 size class 的大小)
+    void* allocate(size_t size, size_t* actualSize);
+
+    // 归还 allocate 得到的内存，size 必须是当时返回的 actualSize
+    void deallocate(void* p, size_t size);
+
+    // 设置每个 size class 空闲链表最多缓存的字节数，超出部分直接 delete
+    void setMaxCachedBytes(size_t bytes) { maxCachedBytes_ = bytes; }
+
+    // 统计信息
+    uint64_t hits() const { return hits_; }                             // 从空闲链表中直接拿到内存的次数
+    uint64_t misses() const { return misses_; }                         // 不得不 operator new 的次数
+    size_t cachedBytes() const;                                         // 空闲链表中缓存的总字节数
+
+    // 把 size 向上取整到对应的 size class，超出最大 class 则原样返回
+    static size_t roundUp(size_t size);
+
+    // 当前线程所属 EventLoop 的内存池，线程中没有 EventLoop 时返回 nullptr
+    static BufferPool* current();
+
+    // 优先从当前线程的内存池分配 / 归还，没有内存池则退化为 operator new / delete
+    static void* alloc(size_t size, size_t* actualSize);
+    static void release(void* p, size_t size);
+
+    // 本 loop 共享的 readv 溢出区，大小为 kSpillBufferSize，第一次读 socket 时才申请
+    // 内容只会被 readv 覆盖，用完立即拷走，因此从不清零，也不需要每次在栈上开辟
+    char* spillBuffer();
+
+private:
+    struct FreeNode
+    {
+        FreeNode* next;
+    };
+
+    // size 对应的 size class 下标，size 必须已经 roundUp 且不超过 kMaxBlockSize
+    static int sizeClassOf(size_t size);
+
+    FreeNode* freeLists_[kNumSizeClasses];                              // 每个 size class 的空闲链表
+    size_t freeCounts_[kNumSizeClasses];                                // 每条空闲链表的块数
+    size_t maxCachedBytes_;
+    char* spillBuffer_;                                                 // readv 溢出区，惰性分配
+
+    uint64_t hits_;
+    uint64_t misses_;
+};
+
+/**
+ * readFd 使用的溢出区: 优先借用当前线程内存池的溢出区，
+ * 线程中没有 EventLoop 时 (很少见) 临时申请一块，用完释放
+ */
+class SpillBuffer : noncopyable
+{
+public:
+    SpillBuffer()
+        : owned_(nullptr)
+    {
+        BufferPool* pool = BufferPool::current();
+        data_ = pool ? pool->spillBuffer() : (owned_ = new char[BufferPool::kSpillBufferSize]);
+    }
+
+    ~SpillBuffer() { delete[] owned_; }
+
+    char* data() const { return data_; }
+    size_t size() const { return BufferPool::kSpillBufferSize; }
+
+private:
+    char* data_;
+    char* owned_;
+};
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <time.h>
 
 #include "Timestamp.h"
 
@@ -11,11 +12,6 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
 {}
 
 Timestamp Timestamp::now()
-{
-    return Timestamp(time(NULL));
-}
-
-Timestamp Timestamp::now1()
 {
     struct timeval tv;
     // 获取微妙和秒
@@ -26,10 +22,19 @@ Timestamp Timestamp::now1()
     return Timestamp(seconds * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
+Timestamp Timestamp::monotonic()
+{
+    // 同样经由 vDSO，不陷入内核
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
+
 std::string Timestamp::toString() const
 {
     char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
+    time_t seconds = secondsSinceEpoch();
+    tm *tm_time = localtime(&seconds);
     snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
         tm_time->tm_year + 1900,
         tm_time->tm_mon + 1,
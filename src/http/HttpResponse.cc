@@ -3,6 +3,10 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <time.h>
 
 /* 重构
         《=========================》
@@ -10,8 +14,78 @@
 
 
 
-// 将响应内容写入缓冲区打包好
+HttpResponse::~HttpResponse()
+{
+    if (fileFd_ >= 0)
+    {
+        ::close(fileFd_);
+    }
+}
+
+bool HttpResponse::setBodyFile(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (fileFd_ >= 0)
+    {
+        ::close(fileFd_);
+    }
+    fileFd_ = fd;
+    fileOffset_ = 0;
+    fileLength_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+// 将响应内容写入缓冲区打包好 (文件响应体不会被读入，需要调用方另行 sendfile)
 void HttpResponse::appendToBuffer(Buffer* output) const
+{
+    appendHeadersToBuffer(output);
+    if (hasBodyFile())
+    {
+        return;
+    }
+
+    // 加入响应体
+    output->append(body_.c_str(), body_.size());
+}
+
+namespace
+{
+
+// 每个 IO 线程缓存一份格式化好的 Date 头部，秒数变化时才重新格式化
+__thread time_t t_dateSeconds = 0;
+__thread char t_dateHeader[64];
+__thread size_t t_dateHeaderLen = 0;
+
+void appendDateHeader(Buffer* output, Timestamp now)
+{
+    time_t seconds = now.secondsSinceEpoch();
+    if (seconds != t_dateSeconds)
+    {
+        struct tm tm_time;
+        ::gmtime_r(&seconds, &tm_time);
+        t_dateHeaderLen = ::strftime(t_dateHeader, sizeof t_dateHeader,
+                                     "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm_time);
+        t_dateSeconds = seconds;
+    }
+    output->append(t_dateHeader, t_dateHeaderLen);
+}
+
+}
+
+// 状态行 + 头部字段 + 空行
+void HttpResponse::appendHeadersToBuffer(Buffer* output) const
 {
     // 响应行
     char buf[32];
@@ -27,11 +101,16 @@ void HttpResponse::appendToBuffer(Buffer* output) const
     }
     else
     {
-        snprintf(buf, sizeof(buf), "Content-Length: %zd\r\n", body_.size());
+        snprintf(buf, sizeof(buf), "Content-Length: %zd\r\n", bodyLength());
         output->append(buf, strlen(buf));
         output->append("Connection: Keep-Alive\r\n", 24);
     }
 
+    if (date_.valid())
+    {
+        appendDateHeader(output, date_);
+    }
+
     // 头部字段
     for (const auto& header : headers_)
     {
@@ -43,7 +122,4 @@ void HttpResponse::appendToBuffer(Buffer* output) const
 
     // 空行
     output->append("\r\n", 2);
-
-    // 加入响应体
-    output->append(body_.c_str(), body_.size());
 }
\ No newline at end of file
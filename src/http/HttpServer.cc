@@ -2,6 +2,7 @@
 #include "Buffer.h"
 
 #include <memory>
+#include <sys/uio.h>
 
 /**
  * 默认的http回调函数
@@ -38,11 +39,11 @@ void HttpServer::onConnection(const TcpConnectionPtr& conn)
 {
     if (conn->connected())
     {
-        LOG_INFO("new Connection arrived");
+        LOG_DEBUG("new Connection arrived");
     }
     else 
     {
-        LOG_INFO("Connection closed");
+        LOG_DEBUG("Connection closed");
     }
 }
 
@@ -52,7 +53,7 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
                            Timestamp receiveTime)
 {
     // LOG_INFO << "HttpServer::onMessage";
-    LOG_INFO("HttpServer::onMessage");
+    LOG_TRACE("HttpServer::onMessage");
     std::unique_ptr<HttpContext> context(new HttpContext);
 
 #if 0
@@ -65,7 +66,7 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
     // 错误则发送 BAD REQUEST 半关闭
     if (!context->parseRequest(buf, receiveTime))
     {
-        LOG_INFO("parseRequest failed!");
+        LOG_DEBUG("parseRequest failed!");
         conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
         conn->shutdown();
     }
@@ -73,7 +74,7 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
     // 如果成功解析
     if (context->gotAll())
     {
-        LOG_INFO("parseRequest success!");
+        LOG_TRACE("parseRequest success!");
         onRequest(conn, context->request());
         context->reset();
     }
@@ -94,17 +95,35 @@ void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
     // 响应信息
     HttpResponse response(close);
 
+    // Date 头部使用请求所在这一轮 poll 返回的时间，不再单独读时钟
+    response.setDate(req.receiveTime());
+
     // httpCallback_ 由用户传入，怎么写响应体由用户决定
     // 此处初始化了一些response的信息，比如响应码，回复OK
     httpCallback_(req, &response);
     Buffer buf;
-    response.appendToBuffer(&buf);
+    response.appendHeadersToBuffer(&buf);
+
+    if (response.hasBodyFile())
+    {
+        // 文件响应体: 先发响应头，文件内容排在其后通过 sendfile 发出
+        conn->send(std::move(buf));
+        conn->sendFile(response.bodyFileFd(), response.bodyFileOffset(), response.bodyFileLength());
+    }
+    else
+    {
+        // 响应头和响应体分散写一次发出，响应体不再经过中间缓冲区
+        const std::string& body = response.body();
+        struct iovec vec[2];
+        vec[0].iov_base = const_cast<char*>(buf.peek());
+        vec[0].iov_len = buf.readableBytes();
+        vec[1].iov_base = const_cast<char*>(body.data());
+        vec[1].iov_len = body.size();
+        conn->send(vec, 2);
+    }
 
-    // TODO:需要重载 TcpConnection::send 使其可以接收一个缓冲区
-    conn->send1(&buf);
     if (response.closeConnection())
     {
         conn->shutdown();
     }
 }
-
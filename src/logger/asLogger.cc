@@ -12,22 +12,43 @@ Logger& Logger::instance()
     return logger;
 }
 
-// 设置日志级别
-void Logger::setLogLevel(int level)
+std::atomic<int> g_logLevel(INFO);
+
+namespace
+{
+
+const char* levelName(int level)
 {
-    logLevel_ = level;
+    switch (level)
+    {
+    case TRACE: return "trace";
+    case DEBUG: return "debug";
+    case INFO:  return "info";
+    case ERROR: return "error";
+    default:    return "fatal";
+    }
 }
 
-// 写日志
-void Logger::log(std::string msg)
+const char* levelTag(int level)
 {
-    m_lckQue.Push(msg);
+    switch (level)
+    {
+    case TRACE: return "[TRACE]";
+    case DEBUG: return "[DEBUG]";
+    case INFO:  return "[INFO]";
+    case ERROR: return "[ERROR]";
+    default:    return "[FATAL]";
+    }
+}
 
-    std::string loglevel;
-    if (logLevel_ == INFO) loglevel = "[INFO]";
-    else if (logLevel_ == ERROR) loglevel = "[ERROR]";
-    else if ((logLevel_ == FATAL)) loglevel = "[FATAL]";
-    else loglevel = "[DEBUG]";
+}
+
+// 写日志 (级别已经由宏检查过)
+void Logger::log(int level, const std::string& msg)
+{
+    m_lckQue.Push(LogEntry(level, msg));
+
+    const char *loglevel = levelTag(level);
 
     // 打印时间
     std::cout << loglevel << Timestamp::now().toString() << " : " << msg << std::endl;
@@ -55,20 +76,15 @@ Logger::Logger()
                 exit(EXIT_FAILURE);
             }
             
-            std::string msg = m_lckQue.Pop();
-
-            std::string loglevel;
-            if (logLevel_ == INFO) loglevel = "info";
-            else if (logLevel_ == ERROR) loglevel = "error";
-            else if ((logLevel_ == FATAL)) loglevel = "fatal";
-            else loglevel = "debug";
+            LogEntry entry = m_lckQue.Pop();
+            std::string& msg = entry.second;
 
 
             // 加入具体时间信息
             char time_buf[128] = {0};
             sprintf(time_buf, "%s => [%s]",
                     Timestamp::now().toString().c_str(),
-                    loglevel.c_str());
+                    levelName(entry.first));
             msg.insert(0, time_buf);
             msg.append("\n");
 
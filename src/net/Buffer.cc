@@ -2,24 +2,268 @@
 #include <sys/uio.h>
 #include <unistd.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BUFFER_HAVE_X86_SIMD 1
+#endif
+
 #include "Buffer.h"
 
 
-const char Buffer::kCRLF[] = "\r\n";
+const size_t Buffer::kMaxReadSizeHint;
+
+/**
+ * 分隔符查找原语，返回值都是 [begin, end) 中第一个匹配的位置，找不到返回 end
+ *   findChar: 查找单个字符 c
+ *   findPair: 查找相邻的两个字符 c0 c1 (如 "\r\n")
+ * SIMD 版本一次比较 16 / 32 个字节，findPair 通过错开一个字节的两次加载，同时比较 c0 和 c1
+ */
+namespace
+{
+
+const char* findCharScalar(const char* begin, const char* end, char c)
+{
+    return std::find(begin, end, c);
+}
+
+const char* findPairScalar(const char* begin, const char* end, char c0, char c1)
+{
+    for (const char* p = begin; p + 1 < end; ++p)
+    {
+        if (p[0] == c0 && p[1] == c1)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+
+#ifdef BUFFER_HAVE_X86_SIMD
+
+__attribute__((target("sse2")))
+const char* findCharSse2(const char* begin, const char* end, char c)
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    const char* p = begin;
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCharScalar(p, end, c);
+}
+
+__attribute__((target("sse2")))
+const char* findPairSse2(const char* begin, const char* end, char c0, char c1)
+{
+    const __m128i first = _mm_set1_epi8(c0);
+    const __m128i second = _mm_set1_epi8(c1);
+    const char* p = begin;
+    // 第二次加载从 p + 1 开始，需要保证 p + 16 也在范围内
+    for (; end - p >= 17; p += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, second));
+        int mask = _mm_movemask_epi8(eq);
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findPairScalar(p, end, c0, c1);
+}
+
+__attribute__((target("avx2")))
+const char* findCharAvx2(const char* begin, const char* end, char c)
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    const char* p = begin;
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCharSse2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* findPairAvx2(const char* begin, const char* end, char c0, char c1)
+{
+    const __m256i first = _mm256_set1_epi8(c0);
+    const __m256i second = _mm256_set1_epi8(c1);
+    const char* p = begin;
+    for (; end - p >= 33; p += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, second));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(eq));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findPairSse2(p, end, c0, c1);
+}
+
+#endif
+
+using FindCharFunc = const char* (*)(const char*, const char*, char);
+using FindPairFunc = const char* (*)(const char*, const char*, char, char);
+
+struct SearchImpl
+{
+    FindCharFunc findChar;
+    FindPairFunc findPair;
+};
+
+// 动态库加载时根据 CPU 能力选择一次实现
+SearchImpl selectSearchImpl()
+{
+    SearchImpl impl = { findCharScalar, findPairScalar };
+#ifdef BUFFER_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        impl.findChar = findCharAvx2;
+        impl.findPair = findPairAvx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        impl.findChar = findCharSse2;
+        impl.findPair = findPairSse2;
+    }
+#endif
+    return impl;
+}
+
+const SearchImpl g_searchImpl = selectSearchImpl();
+
+// 查找 "\r\n\r\n": 先用 findPair 定位 "\r\n"，再检查其后两个字节
+const char* findDoubleCRLFImpl(const char* begin, const char* end)
+{
+    const char* p = begin;
+    while (end - p >= 4)
+    {
+        p = g_searchImpl.findPair(p, end - 2, '\r', '\n');
+        if (p == end - 2)
+        {
+            break;
+        }
+        if (p[2] == '\r' && p[3] == '\n')
+        {
+            return p;
+        }
+        p += 2;
+    }
+    return end;
+}
+
+}
+
+const char* Buffer::findWithMemo(ScanKind kind, size_t patternLen) const
+{
+    const char* start = begin() + std::max(scanIndex_[kind], readerIndex_);
+    const char* end = beginWrite();
+    if (static_cast<size_t>(end - start) < patternLen)
+    {
+        return nullptr;
+    }
+
+    const char* found = end;
+    switch (kind)
+    {
+    case kScanCRLF:
+        found = g_searchImpl.findPair(start, end, '\r', '\n');
+        break;
+    case kScanEOL:
+        found = g_searchImpl.findChar(start, end, '\n');
+        break;
+    case kScanDoubleCRLF:
+        found = findDoubleCRLFImpl(start, end);
+        break;
+    default:
+        break;
+    }
+
+    if (found == end)
+    {
+        // 末尾 patternLen - 1 个字节可能是分隔符的前半部分，下次从这里继续
+        scanIndex_[kind] = writerIndex_ - (patternLen - 1);
+        return nullptr;
+    }
+
+    // 记住命中位置，调用方不 retrieve 而再次查找时可以直接返回
+    scanIndex_[kind] = found - begin();
+    return found;
+}
+
+const char* Buffer::findCRLF() const
+{
+    return findWithMemo(kScanCRLF, 2);
+}
+
+const char* Buffer::findCRLF(const char* start) const
+{
+    const char* crlf = g_searchImpl.findPair(start, beginWrite(), '\r', '\n');
+    return crlf == beginWrite() ? nullptr : crlf;
+}
+
+const char* Buffer::findEOL() const
+{
+    return findWithMemo(kScanEOL, 1);
+}
+
+const char* Buffer::findEOL(const char* start) const
+{
+    const char* eol = g_searchImpl.findChar(start, beginWrite(), '\n');
+    return eol == beginWrite() ? nullptr : eol;
+}
+
+const char* Buffer::findDoubleCRLF() const
+{
+    return findWithMemo(kScanDoubleCRLF, 4);
+}
+
+const char* Buffer::find(char c) const
+{
+    return find(peek(), c);
+}
+
+const char* Buffer::find(const char* start, char c) const
+{
+    const char* pos = g_searchImpl.findChar(start, beginWrite(), c);
+    return pos == beginWrite() ? nullptr : pos;
+}
+
 /**
  *  从 fd 上读取数据    Poller 工作模式未 LT 模式
  *  Buffer 缓冲区有大小的！ 但是从 fd 上读取数据的时候，却不知道 tcp 数据最终大小
 */
 ssize_t  Buffer::readFd(int fd, int* saveErrno)
 {
-    // 单独开辟一个栈上内存空间(64K)
-    char extrabuf[65536] = {0};
+    // 溢出区为本 loop 的内存池共享的一块 64K 内存，readv 直接覆盖写入，不需要每次在栈上开辟并清零
+    SpillBuffer spill;
+    char* extrabuf = spill.data();
+    const size_t extrabufSize = spill.size();
 
 //    struct iovec {
 //        void  *iov_base;    /* Starting address */
 //        size_t iov_len;     /* Number of bytes to transfer */
 //    };
 
+    // 按照本连接学习到的读大小预留可写区域 (同时完成惰性分配)
+    ensureWriteableBytes(readSizeHint_);
+
     // 使用 iovec 
     struct iovec vec[2];
     const size_t writable = writableBytes();
@@ -28,14 +272,14 @@ ssize_t  Buffer::readFd(int fd, int* saveErrno)
     vec[0].iov_base = begin() + writerIndex_;
     vec[0].iov_len = writable;
 
-    // 第二个缓冲区 vec[1] , 对应的就是上面开辟的栈空间
+    // 第二个缓冲区 vec[1] , 对应的就是线程共享的溢出区
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof extrabuf;
+    vec[1].iov_len = extrabufSize;
 
     // ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
     //           所要读取的 fd    包含若干块的 iovec   指定读 iovcnt 块 iovec
 
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+    const int iovcnt = (writable < extrabufSize) ? 2 : 1;
     const ssize_t n = ::readv(fd, vec, iovcnt);
     // readv 高效
 
@@ -50,15 +294,37 @@ ssize_t  Buffer::readFd(int fd, int* saveErrno)
     else   // 不够，往 extrabuf 里面写入了部分数据
     {
         // extrabuf 里面也写入了数据
-        writerIndex_ = buffer_.size();
+        writerIndex_ = capacity_;
 
         // writerIndex_ 开始写 n - writable 大小的数据
         append(extrabuf, n - writable);
     }
 
+    if (n >= 0)
+    {
+        adjustReadSizeHint(static_cast<size_t>(n), writable);
+    }
+
     return n;
 }
 
+/**
+ *  自适应读大小
+ *  - 本次数据溢出到了 extrabuf，说明预留不够，下次预留翻倍，让数据直接落在 buffer 中，省掉一次 append 拷贝
+ *  - 本次读到的数据不到预留的 1/4，说明对端是小请求，预留减半，避免给小请求长期占用大块内存
+*/
+void Buffer::adjustReadSizeHint(size_t n, size_t writable)
+{
+    if (n > writable)
+    {
+        readSizeHint_ = std::min(readSizeHint_ * 2, kMaxReadSizeHint);
+    }
+    else if (n < readSizeHint_ / 4)
+    {
+        readSizeHint_ = std::max(readSizeHint_ / 2, initialSize_);
+    }
+}
+
 // 通过 fd 发送数据
 ssize_t  Buffer::writeFd(int fd, int* saveErrno)
 {
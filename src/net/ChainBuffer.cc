@@ -0,0 +1,224 @@
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "ChainBuffer.h"
+#include "BufferPool.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+ChainBuffer::ChainBuffer(size_t blockSize)
+    : blockSize_(BufferPool::roundUp(std::max(blockSize, sizeof(Block) + 1)))
+    , dataSize_(blockSize_ - sizeof(Block))
+    , head_(nullptr)
+    , tail_(nullptr)
+    , readable_(0)
+    , blockCount_(0)
+{}
+
+ChainBuffer::~ChainBuffer()
+{
+    retrieveAll();
+}
+
+ChainBuffer::Block* ChainBuffer::newBlock()
+{
+    size_t actual = 0;
+    void* mem = BufferPool::alloc(blockSize_, &actual);
+    Block* block = static_cast<Block*>(mem);
+    block->next = nullptr;
+    block->readerIndex = 0;
+    block->writerIndex = 0;
+
+    // 挂到链表尾部
+    if (tail_)
+    {
+        tail_->next = block;
+    }
+    else
+    {
+        head_ = block;
+    }
+    tail_ = block;
+    ++blockCount_;
+    return block;
+}
+
+void ChainBuffer::freeBlock(Block* block)
+{
+    --blockCount_;
+    BufferPool::release(block, blockSize_);
+}
+
+void ChainBuffer::append(const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        Block* block = tail_;
+        if (block == nullptr || block->writerIndex == dataSize_)
+        {
+            block = newBlock();
+        }
+
+        size_t n = std::min(len, dataSize_ - block->writerIndex);
+        memcpy(block->data() + block->writerIndex, data, n);
+        block->writerIndex += n;
+        readable_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    if (len >= readable_)
+    {
+        retrieveAll();
+        return;
+    }
+
+    readable_ -= len;
+    while (len > 0)
+    {
+        size_t n = std::min(len, head_->writerIndex - head_->readerIndex);
+        head_->readerIndex += n;
+        len -= n;
+
+        // 头块已经读空，并且后面还有块，则释放头块 (尾块读空时保留，留给后续 append 复用)
+        if (head_->readerIndex == head_->writerIndex && head_ != tail_)
+        {
+            Block* next = head_->next;
+            freeBlock(head_);
+            head_ = next;
+        }
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    while (head_)
+    {
+        Block* next = head_->next;
+        freeBlock(head_);
+        head_ = next;
+    }
+    tail_ = nullptr;
+    readable_ = 0;
+}
+
+std::string ChainBuffer::retrieveAsString(size_t len)
+{
+    len = std::min(len, readable_);
+    std::string result;
+    result.reserve(len);
+
+    size_t remaining = len;
+    for (Block* block = head_; block && remaining > 0; block = block->next)
+    {
+        size_t n = std::min(remaining, block->writerIndex - block->readerIndex);
+        result.append(block->data() + block->readerIndex, n);
+        remaining -= n;
+    }
+    retrieve(len);
+    return result;
+}
+
+int ChainBuffer::peekIovec(struct iovec* iov, int maxIov) const
+{
+    int cnt = 0;
+    for (Block* block = head_; block && cnt < maxIov; block = block->next)
+    {
+        size_t n = block->writerIndex - block->readerIndex;
+        if (n == 0)
+        {
+            continue;
+        }
+        iov[cnt].iov_base = block->data() + block->readerIndex;
+        iov[cnt].iov_len = n;
+        ++cnt;
+    }
+    return cnt;
+}
+
+/**
+ *  与 Buffer::readFd 思路相同: 先写尾块剩余空间，不够的部分落到本 loop 共享的溢出区，
+ *  再以 append 的方式挂新块，已经写入链表中的数据不会被搬移
+*/
+ssize_t ChainBuffer::readFd(int fd, int* saveErrno)
+{
+    SpillBuffer spill;
+    char* extrabuf = spill.data();
+
+    struct iovec vec[2];
+    const size_t writable = tailWritable();
+    int iovcnt = 0;
+
+    if (writable > 0)
+    {
+        vec[iovcnt].iov_base = tail_->data() + tail_->writerIndex;
+        vec[iovcnt].iov_len = writable;
+        ++iovcnt;
+    }
+    vec[iovcnt].iov_base = extrabuf;
+    vec[iovcnt].iov_len = spill.size();
+    ++iovcnt;
+
+    const ssize_t n = ::readv(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else if (static_cast<size_t>(n) <= writable)
+    {
+        tail_->writerIndex += n;
+        readable_ += n;
+    }
+    else
+    {
+        if (writable > 0)
+        {
+            tail_->writerIndex += writable;
+            readable_ += writable;
+        }
+        append(extrabuf, n - writable);
+    }
+    return n;
+}
+
+// 通过 writev 发送链表上前 maxBytes 字节的可读数据
+ssize_t ChainBuffer::writeFd(int fd, size_t maxBytes, int* saveErrno, size_t* offeredBytes)
+{
+    struct iovec vec[IOV_MAX];
+    int iovcnt = peekIovec(vec, IOV_MAX);
+
+    // 截断到 maxBytes
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i)
+    {
+        if (total + vec[i].iov_len >= maxBytes)
+        {
+            vec[i].iov_len = maxBytes - total;
+            iovcnt = i + 1;
+            total = maxBytes;
+            break;
+        }
+        total += vec[i].iov_len;
+    }
+    if (offeredBytes)
+    {
+        *offeredBytes = total;
+    }
+
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    return n;
+}
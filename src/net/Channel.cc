@@ -16,6 +16,9 @@ Channel::Channel(EventLoop *loop, int fd)
     , events_(0)
     , revents_(0)
     , index_(-1)
+    , edgeTriggered_(false)
+    , registeredEvents_(0)
+    , pendingUpdate_(false)
     , tied_(false)
 {}
 
@@ -63,7 +66,7 @@ void Channel::handleEvent(Timestamp receiveTime)
 // 根据 poller 监听所通知的 channel 发生的具体事件，由channel负责调用具体的回调操作
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-    LOG_INFO("channel handleEvent revents:%d\n", revents_);
+    LOG_TRACE("channel handleEvent revents:%d\n", revents_);
 
     // 关闭事件
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN)) 
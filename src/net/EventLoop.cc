@@ -32,12 +32,18 @@ EventLoop::EventLoop()
     , quit_(false)
     , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())
+    , loopTime_(Timestamp::monotonic())
     , poller_(Poller::newDefaultPoller(this))
     , timerQueue_(new TimerQueue(this))
     , wakeupFd_(createEventfd())
     , wakeupChannel_(new Channel(this, wakeupFd_))
+    , wakeupPending_(false)
+    , wakeupsIssued_(0)
+    , wakeupsSuppressed_(0)
+    , busyPollMicros_(0)
+    , lastActiveMicros_(0)
 {
-    LOG_DEBUG("EventLoop created %p in therad %d \n", this, threadId_)
+    LOG_DEBUG("EventLoop created %p in therad %d \n", this, threadId_);
     if (t_loopInThisThread)
     {
         LOG_FATAL("Another EventLoop %p exists in this thread %d \n", t_loopInThisThread, threadId_);
@@ -79,16 +85,34 @@ void EventLoop::loop()
     while (!quit_) 
     {
         activeChannels_.clear();
+
+        // 忙轮询窗口内不阻塞；定时器并入 poll 超时时，最多阻塞到最早的定时器到期
+        int timeoutMs = timerQueue_->pollTimeoutMs(kPollTimeMs);
+        if (busyPollMicros_ > 0
+            && loopTime_.microSecondsSinceEpoch() - lastActiveMicros_ < busyPollMicros_)
+        {
+            timeoutMs = 0;
+        }
+
         // 监听两类 fd，一种是与客户端之间通信的 fd，另一种是 mainloop 和 subloop 之间通信的 fd （epoll_wait）
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+        loopTime_ = Timestamp::monotonic();
         for (Channel *channel : activeChannels_)
         {
             // Poller 监听哪些 channel 发生了事件，然后上报给 EventLoop，通知 channel 处理相应的事件
             channel->handleEvent(pollReturnTime_);
         }
 
+        // 不使用 timerfd 时在这里处理到期的定时器
+        timerQueue_->expireTimers(loopTime_);
+
         // 执行当前 EventLoop 事件循环需要处理的回调操作
-        doPendingFunctors();
+        size_t ran = doPendingFunctors();
+
+        if (busyPollMicros_ > 0 && (!activeChannels_.empty() || ran > 0))
+        {
+            lastActiveMicros_ = loopTime_.microSecondsSinceEpoch();
+        }
     }
 
     // 记录日志
@@ -125,19 +149,15 @@ void EventLoop::runInLoop(Functor cb)
     }
     else        // 在非 loop 线程中执行 cb, 则唤醒loop所在线程中执行 cb
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
 // 把 cb 放入队列中，唤醒 loop 所在的线程的，执行 cb
 void EventLoop::queueInLoop(Functor cb)
 {
-    // 存在多个不同的 loop 去执行某个 loop 线程的 cb
-    // 所以需要考虑 mutex
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
-    }
+    // 存在多个不同的线程同时向某个 loop 投递 cb，使用无锁的多生产者队列
+    pendingFunctors_.push(std::move(cb));               // 移动进队列，回调捕获的大对象不会被拷贝
 
     // 唤醒相应的，需要执行上面的回调操作
     // || 上 call... 的意思是，当前 loop 正在执行回调，但是loop又有新的回调，所以需要wait一下
@@ -152,8 +172,16 @@ void EventLoop::queueInLoop(Functor cb)
 
 // 唤醒 loop 所在的线程的    向 wakeup fd 写一个数据
 // wakeupChannel 就发生读事件，当前 loop 线程就会被唤醒
+// 自上次处理回调以来只有第一次唤醒真正写 eventfd，其余的都是多余的
 void EventLoop::wakeup()
 {
+    if (wakeupPending_.exchange(true))
+    {
+        wakeupsSuppressed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    wakeupsIssued_.fetch_add(1, std::memory_order_relaxed);
+
     uint64_t one = 1;
     ssize_t n = write(wakeupFd_, &one, sizeof one);
     if (n != sizeof one)
@@ -178,30 +206,47 @@ bool EventLoop::hasChannel(Channel *channel)
     return poller_->hashChannel(channel);
 }
 
+uint64_t EventLoop::pollCalls() const
+{
+    return poller_->pollCalls();
+}
+
+uint64_t EventLoop::pollEvents() const
+{
+    return poller_->pollEvents();
+}
+
+uint64_t EventLoop::pollerCtlCalls() const
+{
+    return poller_->ctlCalls();
+}
+
+bool EventLoop::supportsEdgeTriggered() const
+{
+    return poller_->supportsEdgeTriggered();
+}
+
 // 执行回调
-void EventLoop::doPendingFunctors()
+size_t EventLoop::doPendingFunctors()
 {
     /**
-     *  为什么在此需要创建一个局部的 vec 进行 swap 操作呢？
-     *  因为某个线程需要执行回调操作的时候，可能其他线程此时会向 pendingFunctors_ 里添加回调操作，
-     *  而为了保证容器的安全性我们需要进行加锁，如果不用零时 vec 的话，其他 loop线程 会阻塞于此，
-     *  等待回调操作执行完毕，降低了执行速度，所以我们需要临时 vec
+     *  先把队列中当前可见的回调全部取到 runningFunctors_ 再执行：
+     *  执行过程中新投递的回调留到下一轮，避免回调不断投递回调导致 loop 无法返回 poll
+     *  取之前先清掉 wakeupPending_，此后的投递者会重新写 eventfd，不会丢失唤醒
     */
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
-    // 保证锁的颗粒度尽可能的小
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_);
-    }
+    wakeupPending_.exchange(false);
+    size_t count = pendingFunctors_.popAll(&runningFunctors_);
 
-    for (const Functor &functor : functors) 
+    for (const Functor &functor : runningFunctors_) 
     {
         // 执行当前 loop 需要执行的回调操作
         functor();
     }
+    runningFunctors_.clear();
 
     callingPendingFunctors_ = false;
+    return count;
 }
 
 
@@ -223,18 +268,31 @@ void EventLoop::handleRead()
  */
 
 // 在指定的 timestamp 时间点执行回调函数 cb
-void EventLoop::runAt(Timestamp timestamp, Functor&& cb) {
-    timerQueue_->addTimer(std::move(cb), timestamp, 0.0);
+TimerId EventLoop::runAt(Timestamp timestamp, Functor&& cb) {
+    // 墙上时间换算为单调时钟
+    Timestamp when(timestamp.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch()
+                   + Timestamp::monotonic().microSecondsSinceEpoch());
+    return timerQueue_->addTimer(std::move(cb), when, 0.0);
 }
 
 // 在当前时间 waitTime 秒之后执行回调函数 cb
-void EventLoop::runAfter(double waitTime, Functor&& cb) {
-    Timestamp time(addTime(Timestamp::now(), waitTime)); 
-    runAt(time, std::move(cb));
+TimerId EventLoop::runAfter(double waitTime, Functor&& cb) {
+    Timestamp time(addTime(Timestamp::monotonic(), waitTime)); 
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
 }
 
 // 以 interval 秒为周期，定期执行回调函数 cb
-void EventLoop::runEvery(double interval, Functor&& cb) {
-    Timestamp timestamp(addTime(Timestamp::now(), interval)); 
-    timerQueue_->addTimer(std::move(cb), timestamp, interval);
-}
\ No newline at end of file
+TimerId EventLoop::runEvery(double interval, Functor&& cb) {
+    Timestamp timestamp(addTime(Timestamp::monotonic(), interval)); 
+    return timerQueue_->addTimer(std::move(cb), timestamp, interval);
+}
+
+// 选择定时器的存储结构
+void EventLoop::setTimerEngine(TimerQueue::EngineType type) {
+    timerQueue_->setEngine(type);
+}
+
+// 选择定时器的唤醒方式
+void EventLoop::setUseTimerfd(bool on) {
+    timerQueue_->setUseTimerfd(on);
+}
@@ -0,0 +1,96 @@
+#include <functional>
+
+#include "IdleConnectionReaper.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "asLogger.h"
+
+IdleConnectionReaper::IdleConnectionReaper(EventLoop *loop, double idleSeconds, int buckets)
+    : loop_(loop)
+    , idleSeconds_(idleSeconds)
+    , tickSeconds_(idleSeconds / (buckets > 0 ? buckets : kDefaultBuckets))
+    , buckets_((buckets > 0 ? buckets : kDefaultBuckets) + 1)
+    , current_(0)
+{
+}
+
+// 定时器只持有 weak_ptr，TcpServer 析构后定时器到期什么也不做
+void IdleConnectionReaper::tickTimeout(const std::weak_ptr<IdleConnectionReaper>& weakReaper)
+{
+    std::shared_ptr<IdleConnectionReaper> reaper = weakReaper.lock();
+    if (reaper)
+    {
+        reaper->onTick();
+    }
+}
+
+void IdleConnectionReaper::start()
+{
+    std::weak_ptr<IdleConnectionReaper> weakReaper(shared_from_this());
+    tickTimer_ = loop_->runEvery(tickSeconds_, std::bind(&IdleConnectionReaper::tickTimeout, weakReaper));
+}
+
+void IdleConnectionReaper::stop()
+{
+    tickTimer_.cancel();
+}
+
+void IdleConnectionReaper::add(const std::shared_ptr<TcpConnection>& conn, int *bucket)
+{
+    buckets_[current_][conn.get()] = conn;
+    *bucket = current_;
+}
+
+void IdleConnectionReaper::moveToCurrent(TcpConnection *conn, int *bucket)
+{
+    // 不在环中: 已经被扫描取出，正在关闭
+    if (*bucket < 0)
+    {
+        return;
+    }
+
+    Bucket& from = buckets_[*bucket];
+    Bucket::iterator it = from.find(conn);
+    if (it != from.end())
+    {
+        buckets_[current_][conn] = std::move(it->second);
+        from.erase(it);
+    }
+    *bucket = current_;
+}
+
+void IdleConnectionReaper::remove(TcpConnection *conn, int *bucket)
+{
+    if (*bucket >= 0)
+    {
+        buckets_[*bucket].erase(conn);
+        *bucket = -1;
+    }
+}
+
+/**
+ * 前进一格，新的当前格子里的连接在一整圈内都没有 touch 过，全部强制关闭
+ * 先整格换出再关闭，关闭过程中的 remove 找不到记录，不会修改正在遍历的格子
+ */
+void IdleConnectionReaper::onTick()
+{
+    current_ = (current_ + 1) % static_cast<int>(buckets_.size());
+    sweeping_.swap(buckets_[current_]);
+
+    size_t reaped = 0;
+    for (auto& entry : sweeping_)
+    {
+        std::shared_ptr<TcpConnection> conn = entry.second.lock();
+        if (conn)
+        {
+            conn->forceClose();
+            ++reaped;
+        }
+    }
+    sweeping_.clear();
+
+    if (reaped > 0)
+    {
+        LOG_DEBUG("IdleConnectionReaper loop %p closed %zu idle connections \n", loop_, reaped);
+    }
+}
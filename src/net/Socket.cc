@@ -75,4 +75,14 @@ void Socket::setKeepAlive(bool on)
 {
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof optval);
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+#ifdef SO_ZEROCOPY
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof optval) == 0;
+#else
+    return !on;
+#endif
 }   
@@ -1,17 +1,30 @@
 #include <functional>
 #include <string>
+#include <algorithm>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <string.h>
 #include <strings.h>
 #include <netinet/tcp.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
 
 #include "TcpConnection.h"
 #include "asLogger.h"
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "IdleConnectionReaper.h"
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
 static EventLoop* CheckLoopNotNull(EventLoop* loop)
 {
@@ -35,7 +48,21 @@ TcpConnection::TcpConnection(EventLoop *loop,
     , channel_(new Channel(loop, sockfd))
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
-    , highWaterMark_(64 * 1024 * 1024)  // 64 M 
+    , highWaterMark_(kDefaultHighWaterMark)
+    , lowWaterMark_(0)
+    , aboveHighWaterMark_(false)
+    , shrinkIdleSeconds_(0.0)
+    , maxRetainedBytes_(kDefaultMaxRetainedBytes)
+    , shrinkTimerPending_(false)
+    , bytesBeforeSegments_(0)
+    , segmentBytes_(0)
+    , zeroCopy_(false)
+    , zeroCopyThreshold_(kDefaultZeroCopyThreshold)
+    , zeroCopyNextSeq_(0)
+    , zeroCopyCopied_(0)
+    , edgeTriggered_(false)
+    , edgeReadBudget_(kDefaultEdgeReadBudget)
+    , idleBucket_(-1)
 {
     // 给 Channel 设置相应的回调函数，poller 给 channel 通知感兴趣的事件，Channel 会自动调用他的回调函数
 
@@ -44,14 +71,23 @@ TcpConnection::TcpConnection(EventLoop *loop,
     channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
     channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
 
-    LOG_INFO("TcpConnection::ctor[%s] at fd=%d \n", name_.c_str(), sockfd);
+    LOG_DEBUG("TcpConnection::ctor[%s] at fd=%d \n", name_.c_str(), sockfd);
     
     socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d \n", name_.c_str(), channel_->fd(), (int)state_);
+    LOG_DEBUG("TcpConnection::dtor[%s] at fd=%d state=%d \n", name_.c_str(), channel_->fd(), (int)state_);
+
+    // 关闭还没发完的文件段
+    for (const OutputSegment& seg : segments_)
+    {
+        if (seg.fd >= 0)
+        {
+            ::close(seg.fd);
+        }
+    }
 }
 
 void TcpConnection::send(const std::string &buf)
@@ -65,7 +101,60 @@ void TcpConnection::send(const std::string &buf)
         }
         else
         {
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            // 调用方的字符串随时可能析构，跨线程时必须拷贝一份带进回调
+            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop1, shared_from_this(), buf));
+        }
+    }
+}
+
+void TcpConnection::send(std::string&& message)
+{
+    if (state_ == kConnected)
+    {
+        if (useZeroCopy(message.size()))
+        {
+            // 零拷贝发送期间数据必须一直有效，交给连接持有
+            std::shared_ptr<std::string> owned(new std::string(std::move(message)));
+            if (loop_->isInLoopThread())
+            {
+                sendStringInLoop(owned);
+            }
+            else
+            {
+                loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(owned)));
+            }
+        }
+        else if (loop_->isInLoopThread())
+        {
+            sendInLoop(message.data(), message.size());
+            message.clear();
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop1, shared_from_this(), std::move(message)));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer&& buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread() && !useZeroCopy(buf.readableBytes()))
+        {
+            sendInLoop(buf.peek(), buf.readableBytes());
+            buf.retrieveAll();
+        }
+        else if (loop_->isInLoopThread())
+        {
+            std::shared_ptr<Buffer> owned(new Buffer(std::move(buf)));
+            sendBufferInLoop(owned);
+        }
+        else
+        {
+            // 包一层 shared_ptr，零拷贝发送时由它持有数据直到完成通知；移动 Buffer 只交换指针，不拷贝数据
+            std::shared_ptr<Buffer> owned(new Buffer(std::move(buf)));
+            loop_->runInLoop(std::bind(&TcpConnection::sendBufferInLoop, shared_from_this(), std::move(owned)));
         }
     }
 }
@@ -83,7 +172,8 @@ void TcpConnection::send1(Buffer *buf)
         }
         else
         {
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop1, this, buf->retrieveAllAsString()));
+            // 直接移走整个缓冲区，取代 retrieveAllAsString 的整份拷贝
+            send(std::move(*buf));
         }
     }
 }
@@ -93,10 +183,292 @@ void TcpConnection::sendInLoop1(const std::string& message)
     sendInLoop(message.data(), message.size());
 }
 
+void TcpConnection::sendBufferInLoop(const std::shared_ptr<Buffer>& buf)
+{
+    sendOwnedInLoop(buf, buf->peek(), buf->readableBytes());
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        // dup 一份，文件段的生命周期与调用方的 fd 无关
+        int dupfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dupfd < 0)
+        {
+            LOG_ERROR("TcpConnection::sendFile dup fd=%d failed \n", fd);
+            return;
+        }
+
+        if (loop_->isInLoopThread())
+        {
+            sendFileInLoop(dupfd, offset, len);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), dupfd, offset, len));
+        }
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len)
+{
+    bool faultError = false;
+
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up sending file!");
+        ::close(fd);
+        return;
+    }
+
+    // 输出队列为空时直接 sendfile，大部分小文件在这里就能一次发完
+    if (!isWaitingWritable() && !hasPendingOutput())
+    {
+        ssize_t n = ::sendfile(channel_->fd(), fd, &offset, len);
+        if (n >= 0)
+        {
+            len -= n;
+        }
+        else if (errno != EWOULDBLOCK)
+        {
+            // 对端已断开 (EPIPE / ECONNRESET)，或者文件不能 sendfile / 读取出错 (EINVAL / EIO)，
+            // 排进队列只会在每次 EPOLLOUT 时以同样的方式失败，直接放弃并关闭连接
+            LOG_ERROR("TcpConnection::sendFileInLoop");
+            faultError = true;
+        }
+    }
+
+    if (faultError || len == 0)
+    {
+        ::close(fd);
+        if (faultError)
+        {
+            forceClose();
+        }
+        else if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        return;
+    }
+
+    // 没发完，排进输出队列
+    OutputSegment seg;
+    seg.fd = fd;
+    seg.offset = offset;
+    seg.remaining = len;
+    seg.data = nullptr;
+    appendSegment(seg);
+    checkHighWaterMark();
+
+    if (!channel_->isWriting())
+    {
+        channel_->enableWriting();
+    }
+}
+
+void TcpConnection::appendSegment(OutputSegment& seg)
+{
+    seg.bytesBefore = outputBuffer_.readableBytes() - bytesBeforeSegments_;
+    bytesBeforeSegments_ += seg.bytesBefore;
+    segmentBytes_ += seg.remaining;
+    segments_.push_back(std::move(seg));
+}
+
+bool TcpConnection::setZeroCopy(bool on, size_t threshold)
+{
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    if (on && !socket_->setZeroCopy(true))
+    {
+        LOG_ERROR("TcpConnection::setZeroCopy[%s] SO_ZEROCOPY not supported \n", name_.c_str());
+        return false;
+    }
+    zeroCopy_ = on;
+    zeroCopyThreshold_ = threshold;
+    return true;
+#else
+    (void)threshold;
+    return !on;
+#endif
+}
+
+void TcpConnection::sendStringInLoop(const std::shared_ptr<std::string>& message)
+{
+    sendOwnedInLoop(message, message->data(), message->size());
+}
+
+/**
+ * payload 持有 [data, data + len) 的所有权
+ * 不满足零拷贝条件时退化为普通发送；否则作为零拷贝段排进输出队列，并立刻尝试发送
+ */
+void TcpConnection::sendOwnedInLoop(const std::shared_ptr<void>& payload, const char* data, size_t len)
+{
+    if (!useZeroCopy(len))
+    {
+        sendInLoop(data, len);
+        return;
+    }
+
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        return;
+    }
+
+    // 前面没有排队的数据时直接发送，发不完再关注 EPOLLOUT
+    bool idle = !isWaitingWritable();
+
+    OutputSegment seg;
+    seg.fd = -1;
+    seg.offset = 0;
+    seg.remaining = len;
+    seg.data = data;
+    seg.payload = payload;
+    appendSegment(seg);
+
+    if (idle)
+    {
+        int savedErrno = 0;
+        if (!flushOutput(&savedErrno))
+        {
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection::sendOwnedInLoop");
+            forceClose();
+            return;
+        }
+
+        if (hasPendingOutput())
+        {
+            if (!channel_->isWriting())
+            {
+                channel_->enableWriting();
+            }
+        }
+        else if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+    }
+    checkHighWaterMark();
+}
+
+/**
+ * 每一次成功的 MSG_ZEROCOPY 发送按顺序占用一个 32 位序号，内核以 [lo, hi] 区间的形式
+ * 通过错误队列通知哪些发送已经不再引用用户内存，此时才能释放对应的 payload
+ */
+bool TcpConnection::handleZeroCopyCompletions()
+{
+    bool notified = false;
+#if defined(SO_EE_ORIGIN_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    for (;;)
+    {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+
+        if (::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            break;
+        }
+
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            bool recvErr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                        || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!recvErr)
+            {
+                continue;
+            }
+
+            const struct sock_extended_err* serr = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            notified = true;
+            uint32_t lo = serr->ee_info;
+            uint32_t hi = serr->ee_data;
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                zeroCopyCopied_ += hi - lo + 1;
+            }
+
+            // 序号可能回绕，用有符号差值比较
+            while (!zeroCopyPinned_.empty()
+                   && static_cast<int32_t>(zeroCopyPinned_.front().first - hi) <= 0)
+            {
+                zeroCopyPinned_.pop_front();
+            }
+        }
+    }
+#endif
+    return notified;
+}
+
+void TcpConnection::send(const struct iovec* iov, int iovcnt)
+{
+    // 当属于正在连接的状态
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendvInLoop(iov, iovcnt);
+        }
+        else
+        {
+            // 跨线程时调用方的内存在真正发送前可能已经失效，只能先拼接成一份拷贝
+            std::string message;
+            for (int i = 0; i < iovcnt; ++i)
+            {
+                message.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+            }
+            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop1, shared_from_this(), std::move(message)));
+        }
+    }
+}
+
+void TcpConnection::send(const std::vector<Slice>& slices)
+{
+    // 段数不多时直接用栈上的 iovec 数组，避免一次堆分配
+    const size_t kStackIovecs = 16;
+    struct iovec stackVec[kStackIovecs];
+    std::vector<struct iovec> heapVec;
+    struct iovec* vec = stackVec;
+    if (slices.size() > kStackIovecs)
+    {
+        heapVec.resize(slices.size());
+        vec = heapVec.data();
+    }
+
+    for (size_t i = 0; i < slices.size(); ++i)
+    {
+        vec[i].iov_base = const_cast<char*>(slices[i].data());
+        vec[i].iov_len = slices[i].size();
+    }
+    send(vec, static_cast<int>(slices.size()));
+}
 
-// 发送数据， 应用写的快，内核发送数据慢，需要把待发送数据写入缓冲区，而且设置了水位回调
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
+    struct iovec vec;
+    vec.iov_base = const_cast<void*>(data);
+    vec.iov_len = len;
+    sendvInLoop(&vec, 1);
+}
+
+// 发送数据， 应用写的快，内核发送数据慢，需要把待发送数据写入缓冲区，而且设置了水位回调
+void TcpConnection::sendvInLoop(const struct iovec* iov, int iovcnt)
+{
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; ++i)
+    {
+        len += iov[i].iov_len;
+    }
+
     ssize_t nwrote = 0;
     size_t remaining = len; 
     bool faultError = false;
@@ -108,43 +480,70 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         return ; 
     }
 
-    // 表示 channel_ 第一次开始写数据，而且缓冲区没有待发送的数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    // 表示 channel_ 第一次开始写数据，而且输出队列中没有待发送的数据
+    if (!isWaitingWritable() && !hasPendingOutput())
     {
-        nwrote = ::write(channel_->fd(), data, len);
-        if (nwrote >= 0)
+        // 直接从调用方的内存 writev，每次最多 IOV_MAX 段，内核收下了全部交出的数据就接着写下一批；
+        // 只有写不完 (发送缓冲区满) 才把剩下的拷贝进缓冲区，否则边缘触发下不会再有新的 EPOLLOUT
+        int done = 0;
+        while (done < iovcnt)
         {
-            remaining = len - nwrote;
-            if (remaining == 0 && writeCompleteCallback_)
+            int cnt = std::min(iovcnt - done, IOV_MAX);
+            size_t offered = 0;
+            for (int i = done; i < done + cnt; ++i)
             {
-                // 既然一次性数据发送完成，就不用再给 channel 设置 epollout 事件了
-                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+                offered += iov[i].iov_len;
             }
-        }
-        else  // 出错
-        {
-            nwrote = 0;
-            if (errno != EWOULDBLOCK)
+
+            ssize_t n = ::writev(channel_->fd(), iov + done, cnt);
+            if (n < 0)  // 出错
             {
-                LOG_ERROR("TcpConnection::sendInLoop");
-                if (errno == EPIPE || errno == ECONNRESET)
-                {   
-                    faultError = true;
+                if (errno != EWOULDBLOCK)
+                {
+                    LOG_ERROR("TcpConnection::sendInLoop");
+                    if (errno == EPIPE || errno == ECONNRESET)
+                    {   
+                        faultError = true;
+                    }
                 }
+                break;
             }
+
+            nwrote += n;
+            if (static_cast<size_t>(n) < offered)
+            {
+                break;
+            }
+            done += cnt;
+        }
+
+        remaining = len - nwrote;
+        if (remaining == 0 && writeCompleteCallback_)
+        {
+            // 既然一次性数据发送完成，就不用再给 channel 设置 epollout 事件了
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
         }
     }
 
     // 说明一次性并没有发送完数据，剩余数据需要保存到缓冲区中，且需要改channel注册写事件
     if (!faultError && remaining > 0) 
     {
-        size_t oldLen = outputBuffer_.readableBytes();
-        if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+        // 跳过已经写出的 nwrote 字节，只把内核没有收下的尾部拷贝进 outputBuffer_
+        size_t skip = nwrote;
+        for (int i = 0; i < iovcnt; ++i)
         {
-            // TODO
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+            const char* base = static_cast<const char*>(iov[i].iov_base);
+            size_t n = iov[i].iov_len;
+            if (skip >= n)
+            {
+                skip -= n;
+                continue;
+            }
+            outputBuffer_.append(base + skip, n - skip);
+            skip = 0;
         }
-        outputBuffer_.append((char *)data + nwrote, remaining);
+        checkHighWaterMark();
+
         if (!channel_->isWriting())
         {
             channel_->enableWriting(); // 这里一定要注册channel的写事件 否则poller不会给channel通知epollout
@@ -152,22 +551,108 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     }
 }
 
+void TcpConnection::checkHighWaterMark()
+{
+    size_t pending = pendingOutputBytes();
+    if (!aboveHighWaterMark_ && pending >= highWaterMark_)
+    {
+        aboveHighWaterMark_ = true;
+        if (highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), pending));
+        }
+    }
+}
+
+void TcpConnection::checkLowWaterMark()
+{
+    size_t pending = pendingOutputBytes();
+    if (aboveHighWaterMark_ && pending <= lowWaterMark_)
+    {
+        // 回落到低水位，重新武装高水位回调
+        aboveHighWaterMark_ = false;
+        if (lowWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(lowWaterMarkCallback_, shared_from_this(), pending));
+        }
+    }
+}
+
+void TcpConnection::startRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop()
+{
+    // 连接已经关闭，channel 已从 poller 中注销，不能再注册
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    if (!reading_ || !channel_->isReading())
+    {
+        channel_->enableReading();
+        reading_ = true;
+    }
+}
+
+void TcpConnection::stopRead()
+{
+    loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    if (reading_ || channel_->isReading())
+    {
+        channel_->disableReading();
+        reading_ = false;
+    }
+}
+
 // 关闭连接
 void TcpConnection::shutdown()
 {
     if (state_ == kConnected)
     {
-        setState(kDisconnected);
+        // 写端关闭前输出队列可能还没发完，handleWrite 发完之后看到 kDisconnecting 再关闭写端
+        setState(kDisconnecting);
         loop_->runInLoop(
             std::bind(&TcpConnection::shutdownInLoop, this)
         );
     }
 }
 
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        // 排到本轮末尾执行，调用方 (例如回收环的扫描) 可以安全地继续遍历
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this())
+        );
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    // 期间对端已经关闭 (handleClose 把状态设为 kDisconnected)
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
 void TcpConnection::shutdownInLoop()
 {
     // 说明当前 outputBuffer 中的数据已经全部发送完
-    if (!channel_->isWriting())
+    if (!isWaitingWritable())
     {
         // 关闭写端
         socket_->shutdownWrite();
@@ -175,22 +660,66 @@ void TcpConnection::shutdownInLoop()
 }
 
 
+bool TcpConnection::isWaitingWritable() const
+{
+    // 水平触发下只在有积压时关注写事件；边缘触发下写事件常驻，直接看输出队列
+    return edgeTriggered_ ? hasPendingOutput() : channel_->isWriting();
+}
+
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
     int savedErrno = 0;
     ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    
-    
-    if (n > 0) 
+    size_t total = n > 0 ? n : 0;
+
+    // 边缘触发: 同一次就绪只通知一次，要一直读到 EAGAIN / 对端关闭 / 出错为止
+    // 每次最多读 edgeReadBudget_ 字节，读满预算后把剩下的留到本轮末尾，不让一个高速连接饿死同一 loop 上的其他连接
+    while (edgeTriggered_ && n > 0 && total < edgeReadBudget_)
+    {
+        n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+        if (n > 0)
+        {
+            total += n;
+        }
+    }
+
+    if (total > 0) 
     {
         // 已经建立连接的用户发送可读事件，调用用户传入的回调操作 onMessage
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+
+        if (idleReaper_)
+        {
+            idleReaper_->touch(this, &idleBucket_);
+        }
+
+        if (shrinkIdleSeconds_ > 0.0)
+        {
+            // 大消息处理完后容量远大于剩余数据，直接收缩，避免一次大上传让连接长期占用大块内存
+            size_t capacity = inputBuffer_.internalCapacity();
+            if (capacity > maxRetainedBytes_ && inputBuffer_.readableBytes() < capacity / 4)
+            {
+                inputBuffer_.shrink(0);
+            }
+
+            lastActiveTime_ = loop_->loopTime();
+            if (!shrinkTimerPending_)
+            {
+                scheduleIdleShrink(addTime(lastActiveTime_, shrinkIdleSeconds_));
+            }
+        }
     } 
+
+    if (edgeTriggered_ && n > 0)
+    {
+        // 预算用完，内核中可能还有数据，但不会再有新的边缘通知，排到本轮其他连接之后接着读
+        loop_->queueInLoop(std::bind(&TcpConnection::resumeEdgeRead, shared_from_this(), receiveTime));
+    }
     else if (n == 0)
     {
         handleClose();
     }
-    else
+    else if (n < 0 && !(edgeTriggered_ && savedErrno == EWOULDBLOCK))
     {
         errno = savedErrno;
         LOG_ERROR("TcpConnection::handleRead");
@@ -198,36 +727,173 @@ void TcpConnection::handleRead(Timestamp receiveTime)
     }
 }
 
-void TcpConnection::handleWrite()
+void TcpConnection::resumeEdgeRead(Timestamp receiveTime)
 {
-    if (channel_->isWriting())
+    // 期间连接已关闭或被 stopRead 暂停 (恢复读时重新注册会再报告一次可读)
+    if (state_ == kDisconnected || !channel_->isReading())
     {
-        int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
-        
-        // 正确读取数据
-        if (n > 0)
+        return;
+    }
+    handleRead(receiveTime);
+}
+
+/**
+ * 输出队列由 outputBuffer_ 与其他段交错组成:
+ *   [缓冲区 bytesBefore_0] [段 0] [缓冲区 bytesBefore_1] [段 1] ... [缓冲区剩余部分]
+ * 缓冲区部分用 writev 发出 (outputBuffer_ 为链式缓冲区，所有排队的块一次发出)，
+ * 文件段用 sendfile 发出，零拷贝段用 MSG_ZEROCOPY 发出
+ * 任何一次调用没有写完，都说明内核发送缓冲区已满，等下一次 EPOLLOUT
+ */
+bool TcpConnection::flushOutput(int* savedErrno)
+{
+    while (hasPendingOutput())
+    {
+        if (!segments_.empty() && segments_.front().bytesBefore == 0 && segments_.front().fd < 0)
         {
-            outputBuffer_.retrieve(n);
-            
-            // 说明buffer可读数据都被TcpConnection读取完毕并写入给了客户端
-            // 此时就可以关闭连接，否则还需继续提醒写事件
-            if (outputBuffer_.readableBytes() == 0)
+            OutputSegment& seg = segments_.front();
+            ssize_t n = -1;
+#ifdef MSG_ZEROCOPY
+            n = ::send(channel_->fd(), seg.data + seg.offset, seg.remaining, MSG_ZEROCOPY);
+            if (n < 0 && errno == ENOBUFS)
             {
-                channel_->disableWriting();
-                if (writeCompleteCallback_)
-                {
-                    // 唤醒 loop_ 对应的 thread 线程，执行回调
-                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-                if (state_ == kDisconnecting)
+                // 锁页配额 (optmem) 用尽，这一次退化为普通发送
+                n = ::send(channel_->fd(), seg.data + seg.offset, seg.remaining, 0);
+            }
+            else if (n > 0)
+            {
+                // 完成通知到达之前，内核仍在引用这段内存
+                zeroCopyPinned_.push_back(std::make_pair(zeroCopyNextSeq_++, seg.payload));
+            }
+#else
+            n = ::send(channel_->fd(), seg.data + seg.offset, seg.remaining, 0);
+#endif
+            if (n < 0)
+            {
+                *savedErrno = errno;
+                return errno == EWOULDBLOCK;
+            }
+
+            seg.offset += n;
+            seg.remaining -= n;
+            segmentBytes_ -= n;
+            if (seg.remaining > 0)
+            {
+                return true;
+            }
+            segments_.pop_front();
+        }
+        else if (!segments_.empty() && segments_.front().bytesBefore == 0)
+        {
+            OutputSegment& seg = segments_.front();
+            ssize_t n = ::sendfile(channel_->fd(), seg.fd, &seg.offset, seg.remaining);
+            if (n < 0)
+            {
+                *savedErrno = errno;
+                if (errno == EWOULDBLOCK)
                 {
-                    shutdownInLoop();
+                    return true;
                 }
+                // 硬错误 (EINVAL / EIO 等) 重试也不会成功，丢弃这个文件段，由调用方关闭连接
+                segmentBytes_ -= seg.remaining;
+                ::close(seg.fd);
+                segments_.pop_front();
+                return false;
+            }
+
+            if (n == 0)
+            {
+                // 文件在发送期间被截断，剩余内容已经无法发出
+                LOG_ERROR("TcpConnection::flushOutput file truncated, %zu bytes unsent \n", seg.remaining);
+                segmentBytes_ -= seg.remaining;
+                seg.remaining = 0;
+            }
+            else
+            {
+                seg.remaining -= n;
+                segmentBytes_ -= n;
+            }
+
+            if (seg.remaining > 0)
+            {
+                return true;
+            }
+            ::close(seg.fd);
+            segments_.pop_front();
+        }
+        else
+        {
+            size_t limit = segments_.empty() ? outputBuffer_.readableBytes()
+                                             : segments_.front().bytesBefore;
+            size_t offered = 0;
+            ssize_t n = outputBuffer_.writeFd(channel_->fd(), limit, savedErrno, &offered);
+            if (n < 0)
+            {
+                return *savedErrno == EWOULDBLOCK;
+            }
+
+            outputBuffer_.retrieve(n);
+            if (!segments_.empty())
+            {
+                segments_.front().bytesBefore -= n;
+                bytesBeforeSegments_ -= n;
             }
+
+            // 只有内核没收下全部交出的数据才说明发送缓冲区满了；
+            // 受 IOV_MAX 限制只交出了一部分时继续写，边缘触发下不会再有新的 EPOLLOUT 来接着发
+            if (static_cast<size_t>(n) < offered)
+            {
+                return true;
+            }
+        }
+    }
+    return true;
+}
+
+void TcpConnection::handleWrite()
+{
+    if (channel_->isWriting())
+    {
+        // 边缘触发下写事件常驻，每次可读通知都会带上 EPOLLOUT，输出队列为空时没有事情可做
+        if (edgeTriggered_ && !hasPendingOutput())
+        {
+            return;
         }
-        else{
+
+        int savedErrno = 0;
+        size_t pendingBefore = pendingOutputBytes();
+        if (!flushOutput(&savedErrno))
+        {
+            // 发送出错，输出队列不可能再发出去，关闭连接，避免每次写事件都重复失败
+            errno = savedErrno;
             LOG_ERROR("TcpConnection::handleWrite");
+            forceClose();
+            return;
+        }
+        checkLowWaterMark();
+
+        // 对端在接收大响应 (例如 sendFile) 时不会发送数据，发送有进展同样算作活跃，不能被当成空闲连接回收
+        if (idleReaper_ && pendingOutputBytes() < pendingBefore)
+        {
+            idleReaper_->touch(this, &idleBucket_);
+        }
+
+        // 说明输出队列都被写入给了客户端
+        // 此时就可以关闭连接，否则还需继续提醒写事件
+        if (!hasPendingOutput())
+        {
+            if (!edgeTriggered_)
+            {
+                channel_->disableWriting();
+            }
+            if (writeCompleteCallback_)
+            {
+                // 唤醒 loop_ 对应的 thread 线程，执行回调
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            if (state_ == kDisconnecting)
+            {
+                shutdownInLoop();
+            }
         }
     }
     else{
@@ -237,10 +903,15 @@ void TcpConnection::handleWrite()
 
 void TcpConnection::handleClose()
 {
-    LOG_INFO("fd=%d state=%d", channel_->fd(), (int)state_);
+    LOG_DEBUG("fd=%d state=%d", channel_->fd(), (int)state_);
     setState(kDisconnected);                                // 设置状态为关闭连接状态
     channel_->disableAll();                                 // 注销Channel所有感兴趣事件
 
+    if (idleReaper_)
+    {
+        idleReaper_->remove(this, &idleBucket_);            // 离开回收环
+    }
+
     TcpConnectionPtr connPtr(shared_from_this());
 
     // 执行连接关闭的回调
@@ -252,6 +923,9 @@ void TcpConnection::handleClose()
 
 void TcpConnection::handleError()
 {
+    // 零拷贝的完成通知经由错误队列上报，同样以 EPOLLERR 的形式到达
+    bool notified = !zeroCopyPinned_.empty() && handleZeroCopyCompletions();
+
     int optval;
     socklen_t optlen = sizeof optval;
     int err = 0;
@@ -262,10 +936,57 @@ void TcpConnection::handleError()
     else{
         err = optval;
     }
+    if (notified && err == 0)
+    {
+        return;
+    }
     LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
 }
 
 
+// 空闲收缩定时器只持有 weak_ptr，连接销毁后定时器到期什么也不做
+void TcpConnection::idleShrinkTimeout(const std::weak_ptr<TcpConnection>& weakConn)
+{
+    TcpConnectionPtr conn = weakConn.lock();
+    if (conn)
+    {
+        conn->handleIdleShrink();
+    }
+}
+
+void TcpConnection::scheduleIdleShrink(Timestamp when)
+{
+    shrinkTimerPending_ = true;
+    std::weak_ptr<TcpConnection> weakConn(shared_from_this());
+    double delay = static_cast<double>(when.microSecondsSinceEpoch() - loop_->loopTime().microSecondsSinceEpoch())
+                   / Timestamp::kMicroSecondsPerSecond;
+    loop_->runAfter(delay, std::bind(&TcpConnection::idleShrinkTimeout, weakConn));
+}
+
+/**
+ * 定时器到期时，如果期间又有数据到来，则按最近一次活跃时间重新排队；
+ * 否则收缩输入缓冲区，并且不再排队，直到下次读到数据
+ * 这样大量长期空闲的连接在收缩一次之后不会再产生任何定时器开销
+ */
+void TcpConnection::handleIdleShrink()
+{
+    shrinkTimerPending_ = false;
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+
+    Timestamp deadline = addTime(lastActiveTime_, shrinkIdleSeconds_);
+    if (loop_->loopTime() < deadline)
+    {
+        scheduleIdleShrink(deadline);
+    }
+    else
+    {
+        inputBuffer_.shrink(0);
+    }
+}
+
 // 连接建立
 void TcpConnection::connectEstablished()
 {
@@ -273,8 +994,33 @@ void TcpConnection::connectEstablished()
     setState(kConnected);
     channel_->tie(shared_from_this());
 
-    // 设置该 channel 关注读事件
-    channel_->enableReading();
+    // poll 后端没有边缘触发，常驻的写事件会让 poll 空转，退回水平触发
+    if (edgeTriggered_ && !loop_->supportsEdgeTriggered())
+    {
+        edgeTriggered_ = false;
+    }
+
+    // 设置该 channel 关注读事件；边缘触发时读写事件一次注册，之后不再修改
+    if (edgeTriggered_)
+    {
+        channel_->setEdgeTriggered(true);
+        channel_->enableAll();
+    }
+    else
+    {
+        channel_->enableReading();
+    }
+
+    if (shrinkIdleSeconds_ > 0.0)
+    {
+        lastActiveTime_ = loop_->loopTime();
+        scheduleIdleShrink(addTime(lastActiveTime_, shrinkIdleSeconds_));
+    }
+
+    if (idleReaper_)
+    {
+        idleReaper_->add(shared_from_this(), &idleBucket_);
+    }
 
     // 新建连接，执行回调
     connectionCallback_(shared_from_this());
@@ -26,6 +26,14 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::
     , threadPool_(new EventLoopThreadPool(loop, name_))
     , connectionCallback_()
     , messageCallback_()
+    , highWaterMark_(TcpConnection::kDefaultHighWaterMark)
+    , lowWaterMark_(0)
+    , shrinkIdleSeconds_(0.0)
+    , maxRetainedBytes_(TcpConnection::kDefaultMaxRetainedBytes)
+    , edgeTriggered_(false)
+    , edgeReadBudget_(TcpConnection::kDefaultEdgeReadBudget)
+    , idleSeconds_(0.0)
+    , idleBuckets_(IdleConnectionReaper::kDefaultBuckets)
     , nextConnId_(1)
     , started_(0)
 {
@@ -36,6 +44,14 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::
 
 TcpServer::~TcpServer()
 {
+    // 停止回收环的定时器，连接持有的回收环随最后一个连接销毁
+    for (auto &it : idleReapers_)
+    {
+        it.first->runInLoop(
+            std::bind(&IdleConnectionReaper::stop, it.second)
+        );
+    }
+
     for (auto &it : connections_)
     {
         TcpConnectionPtr conn(it.second);
@@ -62,6 +78,16 @@ void TcpServer::start()
     if (started_++ == 0) 
     {
         threadPool_->start(threadInitCallback_);
+
+        if (idleSeconds_ > 0.0)
+        {
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                std::shared_ptr<IdleConnectionReaper> reaper(new IdleConnectionReaper(ioLoop, idleSeconds_, idleBuckets_));
+                idleReapers_[ioLoop] = reaper;
+                ioLoop->runInLoop(std::bind(&IdleConnectionReaper::start, reaper));
+            }
+        }
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
     }
 }
@@ -103,6 +129,14 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setHighWaterMarkCallback(highWaterMarkCallback_, highWaterMark_);
+    conn->setLowWaterMarkCallback(lowWaterMarkCallback_, lowWaterMark_);
+    conn->setBufferShrinkPolicy(shrinkIdleSeconds_, maxRetainedBytes_);
+    conn->setEdgeTriggered(edgeTriggered_, edgeReadBudget_);
+    if (!idleReapers_.empty())
+    {
+        conn->setIdleReaper(idleReapers_[ioLoop]);
+    }
 
     // 设置了关闭连接的回调
     conn->setCloseCallback(
@@ -125,7 +159,7 @@ void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
 {
-    LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s \n", name_.c_str(), conn->name().c_str());
+    LOG_DEBUG("TcpServer::removeConnectionInLoop [%s] - connection %s \n", name_.c_str(), conn->name().c_str());
 
     connections_.erase(conn->name());
     EventLoop *ioLoop = conn->getLoop();
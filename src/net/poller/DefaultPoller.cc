@@ -2,15 +2,29 @@
 
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "PollPoller.h"
+#include "asLogger.h"
 
 
 // EventLoop 事件循环可以通过该接口获取默认的 IO 复用的具体实现
 Poller* Poller::newDefaultPoller(EventLoop *loop)
 {
+    if (::getenv("MUDUO_USE_URING"))
+    {
+        // io_uring 实例，内核不支持时退回 epoll
+        Poller *poller = IoUringPoller::create(loop);
+        if (poller)
+        {
+            return poller;
+        }
+        LOG_ERROR("io_uring is not available, fall back to epoll \n");
+    }
+
     if (::getenv("MUDUO_USE_POLL")) 
     {
         // Poll 实例
-        return nullptr;
+        return new PollPoller(loop);
     }
     else
     {
@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <strings.h>
+#include <algorithm>
 
 #include "EPollPoller.h"
 #include "Channel.h"
@@ -37,16 +38,18 @@ EPollPoller::~EPollPoller()
 // 扩容操作
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
-    // 应用 LOG_DEBUG 更合理
-    LOG_INFO("func=%s => fd total count:%lu", __FUNCTION__, channels_.size());
+    LOG_TRACE("func=%s => fd total count:%zu", __FUNCTION__, numChannels_);
+
+    applyPendingChanges();
 
     int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
     int saveErrno = errno;
     Timestamp now(Timestamp::now());
+    countPoll(numEvents);
 
     if (numEvents > 0)
     {
-        LOG_INFO("%d events happened \n", numEvents);
+        LOG_TRACE("%d events happened \n", numEvents);
         fillActiveChannels(numEvents, activeChannels);
         if (numEvents == events_.size()) 
         {
@@ -71,41 +74,38 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 void EPollPoller::updateChannel(Channel *channel)
 {
     const int index = channel->index();
-    LOG_INFO("func=%s fd=%d events=%d index=%d", __FUNCTION__, channel->fd(), channel->events(), index);
+    LOG_TRACE("func=%s fd=%d events=%d index=%d", __FUNCTION__, channel->fd(), channel->events(), index);
 
-    if (kNew == index || kDeleted == index)
+    if (kNew == index)
     {
-        if (kNew == index) 
-        {
-            int fd = channel->fd();
-            channels_[fd] = channel;
-        }
-
-        channel->set_index(kAdded);
-        update(EPOLL_CTL_ADD, channel);
+        int fd = channel->fd();
+        setChannel(fd, channel);
+        channel->set_index(kDeleted);
     }
-    else 
+
+    // 关注事件的修改先记下来，等到下一次 epoll_wait 之前统一提交，
+    // 同一轮中的多次修改 (例如先 enableWriting 再 disableWriting) 只按最终结果调用一次 epoll_ctl，没有净变化就不调用
+    if (!channel->pendingUpdate())
     {
-        int fd = channel->fd();
-        if (channel->isNoneEvent())
-        {
-            update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
-        }
-        else
-        {
-            update(EPOLL_CTL_DEL, channel);
-        }
+        channel->set_pendingUpdate(true);
+        pendingChanges_.push_back(channel);
     }
 }
 
 void EPollPoller::removeChannel(Channel *channel)
 {
     int fd = channel->fd();
-    channels_.erase(fd);
+    eraseChannel(fd);
 
     // LOG_INFO("func=%s => fd=%d \n", __FUNCTION__, fd);
 
+    // 删除立即生效，并丢弃还没提交的修改 (channel 随后可能被析构，fd 也可能被关闭后复用)
+    if (channel->pendingUpdate())
+    {
+        channel->set_pendingUpdate(false);
+        pendingChanges_.erase(std::find(pendingChanges_.begin(), pendingChanges_.end(), channel));
+    }
+
     int index =  channel->index();
     if (kAdded == index)
     {
@@ -113,6 +113,34 @@ void EPollPoller::removeChannel(Channel *channel)
     }
     channel->set_index(kNew);
 }
+
+// 把本轮积累的关注事件修改提交给内核，每个 fd 只按 (最终关注的事件 与 已注册的事件) 的差异调用一次 epoll_ctl
+void EPollPoller::applyPendingChanges()
+{
+    for (Channel *channel : pendingChanges_)
+    {
+        channel->set_pendingUpdate(false);
+
+        if (kAdded != channel->index())
+        {
+            if (!channel->isNoneEvent())
+            {
+                update(EPOLL_CTL_ADD, channel);
+                channel->set_index(kAdded);
+            }
+        }
+        else if (channel->isNoneEvent())
+        {
+            update(EPOLL_CTL_DEL, channel);
+            channel->set_index(kDeleted);
+        }
+        else if (epollEvents(channel) != channel->registeredEvents())
+        {
+            update(EPOLL_CTL_MOD, channel);
+        }
+    }
+    pendingChanges_.clear();
+}
     
 void EPollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
 {
@@ -141,6 +169,17 @@ struct epoll_event
 } __EPOLL_PACKED;
 */
 
+// channel 关注的事件对应的 epoll 事件
+uint32_t EPollPoller::epollEvents(Channel *channel)
+{
+    uint32_t events = channel->events();
+    if (channel->isEdgeTriggered())
+    {
+        events |= EPOLLET;
+    }
+    return events;
+}
+
 // 更新 channel 通道   epoll  add / mod / del
 void EPollPoller::update(int operation, Channel *channel)
 {
@@ -149,10 +188,12 @@ void EPollPoller::update(int operation, Channel *channel)
 
     int fd = channel->fd();
 
-    event.events = channel->events();
+    event.events = epollEvents(channel);
     event.data.fd = fd;
     event.data.ptr = channel;
 
+    countCtl();
+    channel->set_registeredEvents(EPOLL_CTL_DEL == operation ? 0 : event.events);
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
         if (EPOLL_CTL_DEL == operation) 
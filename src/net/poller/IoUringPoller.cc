@@ -0,0 +1,412 @@
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+
+#include <algorithm>
+
+#include "IoUringPoller.h"
+#include "Channel.h"
+#include "asLogger.h"
+
+
+const int kNew = -1;        // 表示不在 channels_ 中
+const int kAdded = 1;       // 表示已经加入 channels_
+
+// POLL_REMOVE 请求自身的完成事件，直接忽略
+const uint64_t kRemoveUserData = UINT64_MAX;
+
+static uint64_t makeUserData(int fd, uint32_t generation)
+{
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+IoUringPoller* IoUringPoller::create(EventLoop *loop)
+{
+    IoUringPoller *poller = new IoUringPoller(loop);
+    if (!poller->setup())
+    {
+        delete poller;
+        return nullptr;
+    }
+    return poller;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop)
+    , ringFd_(-1)
+    , sqRing_(MAP_FAILED)
+    , sqRingSize_(0)
+    , sqHead_(nullptr)
+    , sqTail_(nullptr)
+    , sqArray_(nullptr)
+    , sqMask_(0)
+    , sqEntries_(0)
+    , sqes_(static_cast<io_uring_sqe*>(MAP_FAILED))
+    , sqesSize_(0)
+    , sqLocalTail_(0)
+    , toSubmit_(0)
+    , cqRing_(MAP_FAILED)
+    , cqRingSize_(0)
+    , cqHead_(nullptr)
+    , cqTail_(nullptr)
+    , cqMask_(0)
+    , cqes_(nullptr)
+{}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (sqes_ != MAP_FAILED)
+    {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    if (ringFd_ >= 0)
+    {
+        ::close(ringFd_);
+    }
+}
+
+// 创建 io_uring 并映射提交队列、完成队列和 SQE 数组
+bool IoUringPoller::setup()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+
+    ringFd_ = static_cast<int>(::syscall(__NR_io_uring_setup, kRingEntries, &params));
+    if (ringFd_ < 0)
+    {
+        LOG_ERROR("io_uring_setup error:%d \n", errno);
+        return false;
+    }
+
+    // 需要带超时的等待 (EXT_ARG) 和完成队列满时不丢事件 (NODROP)，都是 5.11 之后的内核才有
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+    {
+        LOG_ERROR("io_uring features 0x%x not sufficient \n", params.features);
+        return false;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap sq ring error:%d \n", errno);
+        return false;
+    }
+
+    if (singleMmap)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            LOG_ERROR("io_uring mmap cq ring error:%d \n", errno);
+            return false;
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                              ringFd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap sqes error:%d \n", errno);
+        return false;
+    }
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqLocalTail_ = *sqTail_;
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+    int ret = static_cast<int>(::syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize));
+    if (ret >= 0)
+    {
+        toSubmit_ -= std::min(toSubmit_, static_cast<unsigned>(ret));
+    }
+    return ret;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_TRACE("func=%s => fd total count:%zu", __FUNCTION__, numChannels_);
+
+    applyPendingChanges();
+
+    // 完成队列中已经有事件时不必等待，只把修改提交上去
+    bool ready = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+    int ret = 0;
+    if (timeoutMs == 0 || ready)
+    {
+        if (toSubmit_ > 0)
+        {
+            ret = enter(toSubmit_, 0, 0, nullptr, 0);
+        }
+    }
+    else
+    {
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof arg);
+        if (timeoutMs > 0)
+        {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+        // 提交与等待合并为一次系统调用
+        ret = enter(toSubmit_, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+    }
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret < 0 && saveErrno != EINTR && saveErrno != ETIME && saveErrno != EBUSY)
+    {
+        errno = saveErrno;
+        LOG_ERROR("IoUringPoller::poll() err!");
+    }
+
+    int numEvents = reapCompletions(activeChannels);
+    countPoll(numEvents);
+    if (numEvents > 0)
+    {
+        LOG_TRACE("%d events happened \n", numEvents);
+    }
+    return now;
+}
+
+int IoUringPoller::reapCompletions(ChannelList *activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe &cqe = cqes_[head & cqMask_];
+        if (cqe.user_data == kRemoveUserData)
+        {
+            continue;
+        }
+
+        int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+        uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+        if (fd < 0 || static_cast<size_t>(fd) >= registrations_.size())
+        {
+            continue;
+        }
+        Registration &reg = registrations_[fd];
+        if (reg.channel == nullptr || reg.generation != generation)
+        {
+            // 已经注销或修改过的旧请求
+            continue;
+        }
+
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            // 一次性 poll 已经结束 (multishot 也可能被内核终止)，下一次等待之前重新提交
+            reg.events = 0;
+            scheduleUpdate(reg.channel);
+        }
+
+        int revents = cqe.res >= 0 ? cqe.res : static_cast<int>(EPOLLERR);
+        if (revents == 0)
+        {
+            continue;
+        }
+        if (reg.revents == 0)
+        {
+            readyFds_.push_back(fd);
+        }
+        reg.revents |= revents;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    // 同一 fd 在一轮中的多个完成事件合并为一次分发
+    for (int fd : readyFds_)
+    {
+        Registration &reg = registrations_[fd];
+        reg.channel->set_revents(reg.revents);
+        reg.revents = 0;
+        activeChannels->push_back(reg.channel);
+    }
+    int numEvents = static_cast<int>(readyFds_.size());
+    readyFds_.clear();
+    return numEvents;
+}
+
+IoUringPoller::Registration& IoUringPoller::registration(int fd)
+{
+    if (static_cast<size_t>(fd) >= registrations_.size())
+    {
+        Registration empty = { nullptr, 0, 0, 0 };
+        registrations_.resize(fd + 1, empty);
+    }
+    return registrations_[fd];
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    LOG_TRACE("func=%s fd=%d events=%d index=%d", __FUNCTION__, channel->fd(), channel->events(), channel->index());
+
+    if (kNew == channel->index())
+    {
+        int fd = channel->fd();
+        setChannel(fd, channel);
+        registration(fd).channel = channel;
+        channel->set_index(kAdded);
+    }
+    scheduleUpdate(channel);
+}
+
+void IoUringPoller::scheduleUpdate(Channel *channel)
+{
+    if (!channel->pendingUpdate())
+    {
+        channel->set_pendingUpdate(true);
+        pendingChanges_.push_back(channel);
+    }
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    eraseChannel(fd);
+
+    if (channel->pendingUpdate())
+    {
+        channel->set_pendingUpdate(false);
+        pendingChanges_.erase(std::find(pendingChanges_.begin(), pendingChanges_.end(), channel));
+    }
+
+    // 挂起的 poll 请求随下一次 io_uring_enter 取消，它迟到的完成事件因 generation 不同被丢弃
+    Registration &reg = registration(fd);
+    if (reg.events != 0)
+    {
+        submitPollRemove(fd, reg);
+    }
+    ++reg.generation;
+    reg.events = 0;
+    reg.channel = nullptr;
+    channel->set_index(kNew);
+}
+
+// 每个 fd 只按 (最终关注的事件 与 内核中挂起的请求) 的差异提交 POLL_REMOVE / POLL_ADD
+void IoUringPoller::applyPendingChanges()
+{
+    for (Channel *channel : pendingChanges_)
+    {
+        channel->set_pendingUpdate(false);
+
+        int fd = channel->fd();
+        Registration &reg = registration(fd);
+        uint32_t events = 0;
+        if (!channel->isNoneEvent())
+        {
+            events = channel->events();
+            if (channel->isEdgeTriggered())
+            {
+                events |= EPOLLET;
+            }
+        }
+
+        if (reg.events == events)
+        {
+            continue;
+        }
+        if (reg.events != 0)
+        {
+            submitPollRemove(fd, reg);
+        }
+        ++reg.generation;
+        reg.events = events;
+        if (events != 0)
+        {
+            submitPollAdd(fd, reg);
+        }
+    }
+    pendingChanges_.clear();
+}
+
+void IoUringPoller::submitPollAdd(int fd, const Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = reg.events & ~static_cast<uint32_t>(EPOLLET);
+    if (reg.events & EPOLLET)
+    {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = makeUserData(fd, reg.generation);
+    countCtl();
+}
+
+void IoUringPoller::submitPollRemove(int fd, const Registration &reg)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, reg.generation);
+    sqe->user_data = kRemoveUserData;
+    countCtl();
+}
+
+// 取一个空闲的 SQE，提交队列满时先把已填写的提交给内核
+io_uring_sqe* IoUringPoller::getSqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    while (sqLocalTail_ - head >= sqEntries_)
+    {
+        if (enter(toSubmit_, 0, 0, nullptr, 0) < 0 && errno != EINTR)
+        {
+            LOG_FATAL("io_uring_enter submit error:%d \n", errno);
+        }
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    }
+
+    unsigned index = sqLocalTail_ & sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    ++sqLocalTail_;
+    ++toSubmit_;
+    __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+    return sqe;
+}
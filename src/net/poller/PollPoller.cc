@@ -0,0 +1,118 @@
+#include <errno.h>
+#include <poll.h>
+
+#include <algorithm>
+
+#include "PollPoller.h"
+#include "Channel.h"
+#include "asLogger.h"
+
+
+PollPoller::PollPoller(EventLoop *loop)
+    : Poller(loop)
+{}
+
+PollPoller::~PollPoller() = default;
+
+Timestamp PollPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_TRACE("func=%s => fd total count:%zu", __FUNCTION__, numChannels_);
+
+    int numEvents = ::poll(pollfds_.data(), pollfds_.size(), timeoutMs);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+    countPoll(numEvents);
+
+    if (numEvents > 0)
+    {
+        LOG_TRACE("%d events happened \n", numEvents);
+        fillActiveChannels(numEvents, activeChannels);
+    }
+    else if (numEvents == 0)
+    {
+        LOG_DEBUG("%s timeout! \n", __FUNCTION__);
+    }
+    else
+    {
+        if (saveErrno != EINTR)
+        {
+            errno = saveErrno;
+            LOG_ERROR("PollPoller::poll() err!");
+        }
+    }
+    return now;
+}
+
+void PollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
+{
+    // poll 只返回就绪的个数，需要扫描整个数组，找够 numEvents 个就停止
+    for (PollFdList::const_iterator pfd = pollfds_.begin(); pfd != pollfds_.end() && numEvents > 0; ++pfd)
+    {
+        if (pfd->revents > 0)
+        {
+            --numEvents;
+            Channel *channel = channels_[pfd->fd];
+            if (channel)
+            {
+                channel->set_revents(pfd->revents);
+                activeChannels->push_back(channel);
+            }
+        }
+    }
+}
+
+void PollPoller::updateChannel(Channel *channel)
+{
+    LOG_TRACE("func=%s fd=%d events=%d index=%d", __FUNCTION__, channel->fd(), channel->events(), channel->index());
+
+    if (channel->index() < 0)
+    {
+        // 新的 channel，追加到末尾
+        struct pollfd pfd;
+        pfd.fd = channel->fd();
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        pollfds_.push_back(pfd);
+        channel->set_index(static_cast<int>(pollfds_.size()) - 1);
+        setChannel(pfd.fd, channel);
+    }
+    else
+    {
+        struct pollfd &pfd = pollfds_[channel->index()];
+        pfd.fd = channel->fd();
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        if (channel->isNoneEvent())
+        {
+            // 暂时不关注任何事件，poll 会忽略负的 fd
+            pfd.fd = -channel->fd() - 1;
+        }
+    }
+}
+
+void PollPoller::removeChannel(Channel *channel)
+{
+    int fd = channel->fd();
+    eraseChannel(fd);
+
+    int index = channel->index();
+    if (index < 0)
+    {
+        return;
+    }
+
+    // 把最后一个元素换到空出的位置，并修正它所属 channel 的下标
+    size_t last = pollfds_.size() - 1;
+    if (static_cast<size_t>(index) != last)
+    {
+        std::iter_swap(pollfds_.begin() + index, pollfds_.begin() + last);
+        int movedFd = pollfds_[index].fd;
+        if (movedFd < 0)
+        {
+            movedFd = -movedFd - 1;
+        }
+        channels_[movedFd]->set_index(index);
+    }
+    pollfds_.pop_back();
+    channel->set_index(-1);
+}
@@ -5,15 +5,15 @@
 
 
 Poller::Poller(EventLoop *loop)
-    : ownerLoop_(loop)
+    : numChannels_(0)
+    , ownerLoop_(loop)
+    , pollCalls_(0)
+    , pollEvents_(0)
+    , ctlCalls_(0)
 {}
 
 // 判断参数 channel 是否在当前 Poller 中
 bool Poller::hashChannel(Channel *channel) const
 {
-    auto it = channels_.find(channel->fd());
-
-    // 找到啦并且等于需要找的通道
-    return it != channels_.end() && it->second == channel;
+    return findChannel(channel->fd()) == channel;
 }
-
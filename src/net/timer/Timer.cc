@@ -13,4 +13,5 @@ void Timer::restart(Timestamp now)
     {
         expiration_ = Timestamp();
     }
-}
\ No newline at end of file
+    deadline_ = expiration_;
+}
@@ -0,0 +1,29 @@
+#include "TimerId.h"
+#include "TimerQueue.h"
+
+void TimerId::cancel() const
+{
+    if (queue_)
+    {
+        queue_->cancel(timer_, sequence_);
+    }
+}
+
+void TimerId::reset(Timestamp newDeadline) const
+{
+    if (queue_)
+    {
+        // 墙上时间换算为单调时钟
+        Timestamp when(newDeadline.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch()
+                       + Timestamp::monotonic().microSecondsSinceEpoch());
+        queue_->reschedule(timer_, sequence_, when);
+    }
+}
+
+void TimerId::resetAfter(double delaySeconds) const
+{
+    if (queue_)
+    {
+        queue_->reschedule(timer_, sequence_, addTime(Timestamp::monotonic(), delaySeconds));
+    }
+}
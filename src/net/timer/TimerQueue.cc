@@ -8,6 +8,8 @@
 #include "asLogger.h"
 #include "Timer.h"
 #include "TimerQueue.h"
+#include "TimerTree.h"
+#include "TimerWheel.h"
 
 int createTimerfd()
 {
@@ -27,36 +29,99 @@ int createTimerfd()
 
 TimerQueue::TimerQueue(EventLoop* loop)
     : loop_(loop),
-      timerfd_(createTimerfd()),
-      timerfdChannel_(loop_, timerfd_),
-      timers_()
+      timerfd_(-1),
+      timers_(new TimerTree()),
+      nextSequence_(0),
+      callingExpiredTimers_(false)
 {
-    timerfdChannel_.setReadCallback(
-        std::bind(&TimerQueue::handleRead, this)
-    );
-    timerfdChannel_.enableReading();
+    setUseTimerfdInLoop(true);
 }
 
 TimerQueue::~TimerQueue()
 {   
-    timerfdChannel_.disableAll();
-    timerfdChannel_.remove();
-    ::close(timerfd_);
+    setUseTimerfdInLoop(false);
     // 删除所有定时器
-    for (const Entry& timer : timers_)
+    std::vector<Timer*> timers;
+    timers_->takeAll(&timers);
+    for (Timer* timer : timers)
+    {
+        delete timer;
+    }
+    for (Timer* timer : freeTimers_)
     {
-        delete timer.second;
+        delete timer;
     }
 }
 
-void TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
 {
-    Timer* timer = new Timer(std::move(cb), when, interval);
+    int64_t sequence = ++nextSequence_;
+
+    if (loop_->isInLoopThread())
+    {
+        // 本线程: 复用空闲链表中的定时器对象，直接插入
+        Timer* timer = allocTimer(std::move(cb), when, interval, sequence);
+        addTimerInLoop(timer);
+        return TimerId(this, timer, sequence);
+    }
+
+    // 其他线程不能访问空闲链表，新建定时器对象 (结束后同样进入空闲链表)
+    Timer* timer = new Timer(std::move(cb), when, interval, sequence);
 
     // 在事件循环中加入一个定时器
     loop_->runInLoop(
         std::bind(&TimerQueue::addTimerInLoop, this, timer)
     );
+    return TimerId(this, timer, sequence);
+}
+
+// 刷新超时是每个请求都会做的操作，本线程直接调用，省掉构造回调对象
+void TimerQueue::cancel(Timer* timer, int64_t sequence)
+{
+    if (loop_->isInLoopThread())
+    {
+        cancelInLoop(timer, sequence);
+        return;
+    }
+    loop_->queueInLoop(
+        std::bind(&TimerQueue::cancelInLoop, this, timer, sequence)
+    );
+}
+
+void TimerQueue::reschedule(Timer* timer, int64_t sequence, Timestamp when)
+{
+    if (loop_->isInLoopThread())
+    {
+        rescheduleInLoop(timer, sequence, when);
+        return;
+    }
+    loop_->queueInLoop(
+        std::bind(&TimerQueue::rescheduleInLoop, this, timer, sequence, when)
+    );
+}
+
+Timer* TimerQueue::allocTimer(TimerCallback cb, Timestamp when, double interval, int64_t sequence)
+{
+    if (freeTimers_.empty())
+    {
+        return new Timer(std::move(cb), when, interval, sequence);
+    }
+    Timer* timer = freeTimers_.back();
+    freeTimers_.pop_back();
+    timer->reinit(std::move(cb), when, interval, sequence);
+    return timer;
+}
+
+void TimerQueue::recycleTimer(Timer* timer)
+{
+    timer->release();
+    freeTimers_.push_back(timer);
+}
+
+bool TimerQueue::insert(Timer* timer)
+{
+    timer->setQueued(true);
+    return timers_->insert(timer);
 }
 
 void TimerQueue::addTimerInLoop(Timer* timer)
@@ -64,10 +129,10 @@ void TimerQueue::addTimerInLoop(Timer* timer)
     // 是否取代了最早的定时触发时间
     bool eraliestChanged = insert(timer);
 
-    // 我们需要重新设置 timerfd_ 触发时间
-    if (eraliestChanged)
+    // 我们需要重新设置 timerfd_ 触发时间，正在处理到期定时器时由 processExpired 最后统一设置
+    if (eraliestChanged && !callingExpiredTimers_)
     {
-        resetTimerfd(timerfd_, timer->expiration());
+        arm(timer->expiration());
     }
 }
 
@@ -93,7 +158,7 @@ void TimerQueue::resetTimerfd(int timerfd_, Timestamp expiration)
     memset(&oldValue, '\0', sizeof(oldValue));
 
     // 超时时间 - 现在时间
-    int64_t microSecondDif = expiration.microSecondsSinceEpoch() - Timestamp::now1().microSecondsSinceEpoch();
+    int64_t microSecondDif = expiration.microSecondsSinceEpoch() - Timestamp::monotonic().microSecondsSinceEpoch();
     if (microSecondDif < 100)
     {
         microSecondDif = 100;
@@ -122,84 +187,241 @@ void ReadTimerFd(int timerfd)
     }
 }
 
-// 根据当前的时间戳，确定哪些定时任务到期，
-// 然后返回并删除的定时器节点 （std::vector<Entry> expired）
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+void TimerQueue::handleRead()
 {
-    std::vector<Entry> expired;
-
-    // 创建一个哨兵（sentry）节点，用于查找所有已到期的定时器
-    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
-
-    // lower_bound 根据具体时间戳，返回第一个大于或等于哨兵节点的定时器迭代器
-    TimerList::iterator end = timers_.lower_bound(sentry);
-
-    // 将所有已到期的定时器节点复制到 expired 向量中并从定时器队列中删除已到期的定时器节点
-    std::copy(timers_.begin(), end, back_inserter(expired));
-    timers_.erase(timers_.begin(), end);
-    
-    return expired;
+    ReadTimerFd(timerfd_);
+    // timerfd 在 poll 返回之前就已经到期，本轮的 loop 时间不会早于任何应当触发的定时器
+    processExpired(loop_->loopTime());
 }
 
-void TimerQueue::handleRead()
+void TimerQueue::processExpired(Timestamp now)
 {
-    Timestamp now = Timestamp::now1();
-    ReadTimerFd(timerfd_);
+    // timerfd 是一次性的，触发之后就没有设置唤醒时间了
+    armedExpiration_ = Timestamp::invalid();
 
-    std::vector<Entry> expired = getExpired(now);
+    expired_.clear();
+    timers_->getExpired(now, &expired_);
+    for (Timer* timer : expired_)
+    {
+        timer->setQueued(false);
+    }
 
     // 遍历到期的定时器，调用回调函数
+    // 已被取消的、或者被推迟到更晚时刻的不执行 (推迟的在 reset 中按新的时间重新插入)
+    // 回调中新加入的定时器不设置唤醒时间，全部处理完之后只设置一次
     callingExpiredTimers_ = true;
-    for (const Entry& it : expired)
+    for (Timer* timer : expired_)
     {
-        it.second->run();
+        if (timer->canceled() || now < timer->deadline())
+        {
+            continue;
+        }
+        timer->clearDeadline();
+        timer->run();
     }
     callingExpiredTimers_ = false;
     
     // 重新设置这些定时器
-    reset(expired, now);
+    reset(expired_, now);
 
+    // 时间轮降层时可能没有定时器到期，只要还有定时器就需要重新设置
+    rearm();
 }
 
-// 重新设置定时任务，重复任务则继续加入定时红黑树，一次任务直接删除
-void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
+// 重新设置定时任务，重复任务则继续加入定时器存储结构，一次任务回收到空闲链表
+void TimerQueue::reset(const std::vector<Timer*>& expired, Timestamp now)
 {
-    Timestamp nextExpire;
-    for (const Entry& it : expired)
+    for (Timer* timer : expired)
     {
-        // 重复任务则继续执行
-        if (it.second->repeat())
+        if (timer->canceled())
+        {
+            recycleTimer(timer);
+        }
+        else if (timer->deadline().valid())
         {
-            auto timer = it.second;
-            timer->restart(Timestamp::now1());
+            // 被推迟而没有执行，或者回调中调用了 reset: 按新的到期时间重新插入
+            timer->moveTo(timer->deadline());
+            insert(timer);
+        }
+        else if (timer->repeat())
+        {
+            // 重复任务则继续执行
+            timer->restart(now);
             insert(timer);
         }
         else
         {
-            delete it.second;
+            recycleTimer(timer);
         }
+    }
+}
+
+void TimerQueue::cancelInLoop(Timer* timer, int64_t sequence)
+{
+    if (timer->sequence() != sequence)
+    {
+        // 定时器已经结束，对象可能已被复用
+        return;
+    }
+
+    if (timer->queued())
+    {
+        timers_->remove(timer);
+        timer->setQueued(false);
+        recycleTimer(timer);
+    }
+    else
+    {
+        // 正处于本轮到期的定时器中 (例如在自己的回调中取消)，回调结束后由 reset 回收
+        timer->cancel();
+    }
+}
 
-        // 如果重新插入了定时器，需要继续重置timerfd
-        if (!timers_.empty())
+void TimerQueue::rescheduleInLoop(Timer* timer, int64_t sequence, Timestamp when)
+{
+    if (timer->sequence() != sequence || timer->canceled())
+    {
+        return;
+    }
+
+    if (!timer->queued())
+    {
+        // 正处于本轮到期的定时器中，回调结束后由 reset 按 deadline 重新插入
+        timer->setDeadline(when);
+    }
+    else if (!(when < timer->expiration()))
+    {
+        // 推迟: 只记录新的到期时间，原来的位置到期时再重新插入，不动存储结构
+        timer->setDeadline(when);
+    }
+    else
+    {
+        // 提前: 需要从存储结构中取出重新插入
+        timers_->remove(timer);
+        timer->moveTo(when);
+        if (insert(timer) && !callingExpiredTimers_)
         {
-            resetTimerfd(timerfd_, (timers_.begin()->second)->expiration());
+            arm(when);
         }
     }
 }
 
-bool TimerQueue::insert(Timer* timer)
+// 切换存储结构
+void TimerQueue::setEngine(EngineType type)
+{
+    loop_->runInLoop(
+        std::bind(&TimerQueue::setEngineInLoop, this, type)
+    );
+}
+
+void TimerQueue::setEngineInLoop(EngineType type)
+{
+    std::unique_ptr<TimerEngine> engine;
+    if (type == kTimerWheel)
+    {
+        engine.reset(new TimerWheel(Timestamp::monotonic()));
+    }
+    else
+    {
+        engine.reset(new TimerTree());
+    }
+
+    // 迁移已有的定时器
+    std::vector<Timer*> timers;
+    timers_->takeAll(&timers);
+    for (Timer* timer : timers)
+    {
+        engine->insert(timer);
+    }
+    timers_ = std::move(engine);
+
+    // 时间轮的唤醒时间按毫秒取整，与原来的不同
+    armedExpiration_ = Timestamp::invalid();
+    rearm();
+}
+
+void TimerQueue::arm(Timestamp expiration)
+{
+    if (expiration == armedExpiration_)
+    {
+        return;
+    }
+    armedExpiration_ = expiration;
+    if (timerfd_ >= 0)
+    {
+        resetTimerfd(timerfd_, expiration);
+    }
+}
+
+void TimerQueue::rearm()
+{
+    if (timers_->empty())
+    {
+        // 没有定时器时 timerfd 保持原样，多触发一次也只是取不到定时器
+        armedExpiration_ = Timestamp::invalid();
+        return;
+    }
+    arm(timers_->nextExpiration());
+}
+
+void TimerQueue::setUseTimerfd(bool on)
 {
-    bool earliestChanged = false;
-    Timestamp when = timer->expiration();
-    TimerList::iterator it = timers_.begin();
-    if (it == timers_.end() || when < it->first)
+    loop_->runInLoop(
+        std::bind(&TimerQueue::setUseTimerfdInLoop, this, on)
+    );
+}
+
+void TimerQueue::setUseTimerfdInLoop(bool on)
+{
+    if (on == (timerfd_ >= 0))
+    {
+        return;
+    }
+
+    if (on)
+    {
+        timerfd_ = createTimerfd();
+        timerfdChannel_.reset(new Channel(loop_, timerfd_));
+        timerfdChannel_->setReadCallback(
+            std::bind(&TimerQueue::handleRead, this)
+        );
+        timerfdChannel_->enableReading();
+    }
+    else
     {
-        // 说明最早的定时器已经被替换了
-        earliestChanged = true;
+        timerfdChannel_->disableAll();
+        timerfdChannel_->remove();
+        timerfdChannel_.reset();
+        ::close(timerfd_);
+        timerfd_ = -1;
     }
 
-    // 定时器管理红黑树插入此新定时器
-    timers_.insert(Entry(when, timer));
+    // 按新的方式重新设置唤醒时间
+    armedExpiration_ = Timestamp::invalid();
+    rearm();
+}
 
-    return earliestChanged;
-}
\ No newline at end of file
+int TimerQueue::pollTimeoutMs(int maxMs) const
+{
+    if (timerfd_ >= 0 || !armedExpiration_.valid())
+    {
+        return maxMs;
+    }
+    int64_t microSecondDif = armedExpiration_.microSecondsSinceEpoch() - Timestamp::monotonic().microSecondsSinceEpoch();
+    if (microSecondDif <= 0)
+    {
+        return 0;
+    }
+    // 向上取整，poll 超时返回时定时器一定已经到期
+    int64_t ms = (microSecondDif + 999) / 1000;
+    return ms < maxMs ? static_cast<int>(ms) : maxMs;
+}
+
+void TimerQueue::expireTimers(Timestamp now)
+{
+    if (timerfd_ >= 0 || !armedExpiration_.valid() || now < armedExpiration_)
+    {
+        return;
+    }
+    processExpired(now);
+}
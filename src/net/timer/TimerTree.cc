@@ -0,0 +1,56 @@
+#include <stdint.h>
+
+#include "TimerTree.h"
+#include "Timer.h"
+
+bool TimerTree::insert(Timer *timer)
+{
+    bool earliestChanged = false;
+    Timestamp when = timer->expiration();
+    TimerList::iterator it = timers_.begin();
+    if (it == timers_.end() || when < it->first)
+    {
+        // 说明最早的定时器已经被替换了
+        earliestChanged = true;
+    }
+
+    // 定时器管理红黑树插入此新定时器
+    timers_.insert(Entry(when, timer));
+
+    return earliestChanged;
+}
+
+void TimerTree::remove(Timer *timer)
+{
+    timers_.erase(Entry(timer->expiration(), timer));
+}
+
+// 根据当前的时间戳，确定哪些定时任务到期，取出并从红黑树中删除
+void TimerTree::getExpired(Timestamp now, std::vector<Timer*> *expired)
+{
+    // 创建一个哨兵（sentry）节点，用于查找所有已到期的定时器
+    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+
+    // lower_bound 根据具体时间戳，返回第一个大于或等于哨兵节点的定时器迭代器
+    TimerList::iterator end = timers_.lower_bound(sentry);
+
+    for (TimerList::iterator it = timers_.begin(); it != end; ++it)
+    {
+        expired->push_back(it->second);
+    }
+    timers_.erase(timers_.begin(), end);
+}
+
+Timestamp TimerTree::nextExpiration() const
+{
+    return timers_.empty() ? Timestamp::invalid() : timers_.begin()->first;
+}
+
+void TimerTree::takeAll(std::vector<Timer*> *timers)
+{
+    for (const Entry& entry : timers_)
+    {
+        timers->push_back(entry.second);
+    }
+    timers_.clear();
+}
@@ -0,0 +1,302 @@
+#include <string.h>
+
+#include "TimerWheel.h"
+#include "Timer.h"
+
+const int TimerWheel::kLevels;
+const int TimerWheel::kRootBits;
+const int TimerWheel::kLevelBits;
+const int TimerWheel::kRootSlots;
+const int TimerWheel::kLevelSlots;
+const int TimerWheel::kNumSlots;
+const int64_t TimerWheel::kMaxDelta;
+const int64_t TimerWheel::kNoTick;
+
+namespace
+{
+
+const int64_t kMicroSecondsPerTick = 1000;
+
+// 第 level 层 (>= 1) 槽下标在刻度中的起始位
+inline int levelShift(int level)
+{
+    return 8 + (level - 1) * 6;
+}
+
+// 第 level 层 (>= 1) 第 index 个槽的全局下标
+inline int levelSlot(int level, int index)
+{
+    return 256 + (level - 1) * 64 + index;
+}
+
+// 在位图 words 中从 from 位开始 (含) 找第一个置位的位，到 nbits 为止，找不到返回 -1
+int findNextSet(const uint64_t *words, int nbits, int from)
+{
+    for (int i = from; i < nbits; )
+    {
+        uint64_t word = words[i / 64] >> (i % 64);
+        if (word)
+        {
+            return i + __builtin_ctzll(word);
+        }
+        i = (i / 64 + 1) * 64;
+    }
+    return -1;
+}
+
+}
+
+TimerWheel::TimerWheel(Timestamp now)
+    : currentTick_(now.microSecondsSinceEpoch() / kMicroSecondsPerTick)
+    , earliestTick_(kNoTick)
+    , size_(0)
+{
+    memset(slots_, 0, sizeof slots_);
+    memset(occupied_, 0, sizeof occupied_);
+}
+
+int64_t TimerWheel::tickOf(Timestamp when)
+{
+    return (when.microSecondsSinceEpoch() + kMicroSecondsPerTick - 1) / kMicroSecondsPerTick;
+}
+
+bool TimerWheel::insert(Timer *timer)
+{
+    if (size_ == 0)
+    {
+        // 时间轮为空时把刻度拨到当前时间，避免长时间空闲后从很久以前的刻度开始分层
+        int64_t nowTick = Timestamp::monotonic().microSecondsSinceEpoch() / kMicroSecondsPerTick;
+        if (nowTick > currentTick_)
+        {
+            currentTick_ = nowTick;
+        }
+    }
+
+    // 已经到期的定时器放到下一个刻度，下一次处理时立即触发
+    int64_t tick = tickOf(timer->expiration());
+    if (tick <= currentTick_)
+    {
+        tick = currentTick_ + 1;
+    }
+    place(timer, tick);
+    ++size_;
+
+    if (tick < earliestTick_)
+    {
+        earliestTick_ = tick;
+        return true;
+    }
+    return false;
+}
+
+void TimerWheel::place(Timer *timer, int64_t tick)
+{
+    int64_t delta = tick - currentTick_;
+    if (delta < kRootSlots)
+    {
+        // 降层时 delta 可能为 0，放进当前槽，随后就会被取出
+        link(timer, static_cast<int>(tick & (kRootSlots - 1)));
+        return;
+    }
+
+    if (delta > kMaxDelta)
+    {
+        // 超出时间轮的范围，先放在最高层最远的位置，降层时再重新计算
+        tick = currentTick_ + kMaxDelta;
+        delta = kMaxDelta;
+    }
+
+    int level = 1;
+    while (delta >= (1LL << (levelShift(level) + kLevelBits)))
+    {
+        ++level;
+    }
+    link(timer, levelSlot(level, static_cast<int>((tick >> levelShift(level)) & (kLevelSlots - 1))));
+}
+
+void TimerWheel::link(Timer *timer, int slot)
+{
+    Timer *head = slots_[slot];
+    timer->wheelPrev_ = nullptr;
+    timer->wheelNext_ = head;
+    timer->wheelSlot_ = slot;
+    if (head)
+    {
+        head->wheelPrev_ = timer;
+    }
+    slots_[slot] = timer;
+    occupied_[slot / 64] |= 1ULL << (slot % 64);
+}
+
+void TimerWheel::unlink(Timer *timer)
+{
+    int slot = timer->wheelSlot_;
+    if (timer->wheelPrev_)
+    {
+        timer->wheelPrev_->wheelNext_ = timer->wheelNext_;
+    }
+    else
+    {
+        slots_[slot] = timer->wheelNext_;
+    }
+    if (timer->wheelNext_)
+    {
+        timer->wheelNext_->wheelPrev_ = timer->wheelPrev_;
+    }
+    if (slots_[slot] == nullptr)
+    {
+        occupied_[slot / 64] &= ~(1ULL << (slot % 64));
+    }
+    timer->wheelPrev_ = nullptr;
+    timer->wheelNext_ = nullptr;
+    timer->wheelSlot_ = -1;
+}
+
+// earliestTick_ 不随之更新，最多多一次空的唤醒
+void TimerWheel::remove(Timer *timer)
+{
+    if (timer->wheelSlot_ >= 0)
+    {
+        unlink(timer);
+        --size_;
+    }
+}
+
+int64_t TimerWheel::nextEventTick() const
+{
+    int64_t next = kNoTick;
+
+    // 第 0 层: 当前槽已经取空，从下一个槽开始环形查找
+    int current = static_cast<int>(currentTick_ & (kRootSlots - 1));
+    int slot = findNextSet(occupied_, kRootSlots, current + 1);
+    if (slot < 0)
+    {
+        slot = findNextSet(occupied_, current, 0);
+    }
+    if (slot >= 0)
+    {
+        next = currentTick_ + ((slot - current) & (kRootSlots - 1));
+    }
+
+    // 高层: 第 k 个之后的槽在低位全为 0、本层下标轮到它的刻度降层，取最近的非空槽
+    for (int level = 1; level < kLevels; ++level)
+    {
+        uint64_t word = occupied_[3 + level];
+        if (word == 0)
+        {
+            continue;
+        }
+        int shift = levelShift(level);
+        int index = static_cast<int>((currentTick_ >> shift) & (kLevelSlots - 1));
+        int from = (index + 1) & (kLevelSlots - 1);
+        uint64_t rotated = from == 0 ? word : (word >> from) | (word << (kLevelSlots - from));
+        int64_t k = __builtin_ctzll(rotated) + 1;
+        int64_t tick = ((currentTick_ >> shift) + k) << shift;
+        if (tick < next)
+        {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+void TimerWheel::cascade(int level)
+{
+    int index = static_cast<int>((currentTick_ >> levelShift(level)) & (kLevelSlots - 1));
+    int slot = levelSlot(level, index);
+    Timer *timer = slots_[slot];
+    slots_[slot] = nullptr;
+    occupied_[slot / 64] &= ~(1ULL << (slot % 64));
+
+    // 按当前刻度重新分配到低层 (同一层中的定时器下标也会不同，直到降到第 0 层)
+    while (timer)
+    {
+        Timer *next = timer->wheelNext_;
+        place(timer, tickOf(timer->expiration()));
+        timer = next;
+    }
+}
+
+void TimerWheel::step(std::vector<Timer*> *expired)
+{
+    ++currentTick_;
+
+    // 低层转完一圈，依次把上一层当前槽降下来
+    for (int level = 1; level < kLevels; ++level)
+    {
+        int shift = levelShift(level);
+        if ((currentTick_ & ((1LL << shift) - 1)) != 0)
+        {
+            break;
+        }
+        cascade(level);
+    }
+
+    int slot = static_cast<int>(currentTick_ & (kRootSlots - 1));
+    Timer *timer = slots_[slot];
+    slots_[slot] = nullptr;
+    occupied_[slot / 64] &= ~(1ULL << (slot % 64));
+    while (timer)
+    {
+        Timer *next = timer->wheelNext_;
+        timer->wheelPrev_ = nullptr;
+        timer->wheelNext_ = nullptr;
+        timer->wheelSlot_ = -1;
+        expired->push_back(timer);
+        --size_;
+        timer = next;
+    }
+}
+
+void TimerWheel::getExpired(Timestamp now, std::vector<Timer*> *expired)
+{
+    int64_t nowTick = now.microSecondsSinceEpoch() / kMicroSecondsPerTick;
+
+    // 直接跳到下一个需要处理的刻度，中间的空刻度不用逐个走过
+    while (size_ > 0)
+    {
+        int64_t next = nextEventTick();
+        if (next > nowTick)
+        {
+            break;
+        }
+        currentTick_ = next - 1;
+        step(expired);
+    }
+    if (nowTick > currentTick_)
+    {
+        currentTick_ = nowTick;
+    }
+
+    earliestTick_ = size_ > 0 ? nextEventTick() : kNoTick;
+}
+
+Timestamp TimerWheel::nextExpiration() const
+{
+    if (size_ == 0)
+    {
+        return Timestamp::invalid();
+    }
+    return Timestamp(earliestTick_ * kMicroSecondsPerTick);
+}
+
+void TimerWheel::takeAll(std::vector<Timer*> *timers)
+{
+    for (int slot = 0; slot < kNumSlots; ++slot)
+    {
+        Timer *timer = slots_[slot];
+        while (timer)
+        {
+            Timer *next = timer->wheelNext_;
+            timer->wheelPrev_ = nullptr;
+            timer->wheelNext_ = nullptr;
+            timer->wheelSlot_ = -1;
+            timers->push_back(timer);
+            timer = next;
+        }
+        slots_[slot] = nullptr;
+    }
+    memset(occupied_, 0, sizeof occupied_);
+    size_ = 0;
+    earliestTick_ = kNoTick;
+}
@@ -0,0 +1,163 @@
+#include <new>
+
+#include "BufferPool.h"
+
+// 每个线程最多一个 EventLoop，也就最多一个当前内存池
+__thread BufferPool* t_bufferPoolInThisThread = nullptr;
+
+BufferPool::BufferPool()
+    : maxCachedBytes_(kDefaultMaxCachedBytes)
+    , spillBuffer_(nullptr)
+    , hits_(0)
+    , misses_(0)
+{
+    for (int i = 0; i < kNumSizeClasses; ++i)
+    {
+        freeLists_[i] = nullptr;
+        freeCounts_[i] = 0;
+    }
+
+    if (t_bufferPoolInThisThread == nullptr)
+    {
+        t_bufferPoolInThisThread = this;
+    }
+}
+
+BufferPool::~BufferPool()
+{
+    if (t_bufferPoolInThisThread == this)
+    {
+        t_bufferPoolInThisThread = nullptr;
+    }
+
+    // 释放所有缓存的空闲块
+    for (int i = 0; i < kNumSizeClasses; ++i)
+    {
+        while (freeLists_[i])
+        {
+            FreeNode* next = freeLists_[i]->next;
+            ::operator delete(freeLists_[i]);
+            freeLists_[i] = next;
+        }
+        freeCounts_[i] = 0;
+    }
+    delete[] spillBuffer_;
+}
+
+size_t BufferPool::roundUp(size_t size)
+{
+    if (size > kMaxBlockSize)
+    {
+        return size;
+    }
+
+    size_t blockSize = kMinBlockSize;
+    while (blockSize < size)
+    {
+        blockSize <<= 1;
+    }
+    return blockSize;
+}
+
+int BufferPool::sizeClassOf(size_t size)
+{
+    int idx = 0;
+    size_t blockSize = kMinBlockSize;
+    while (blockSize < size)
+    {
+        blockSize <<= 1;
+        ++idx;
+    }
+    return idx;
+}
+
+void* BufferPool::allocate(size_t size, size_t* actualSize)
+{
+    size = roundUp(size);
+    *actualSize = size;
+
+    if (size <= kMaxBlockSize)
+    {
+        int idx = sizeClassOf(size);
+        FreeNode* node = freeLists_[idx];
+        if (node)
+        {
+            // 命中空闲链表
+            freeLists_[idx] = node->next;
+            --freeCounts_[idx];
+            ++hits_;
+            return node;
+        }
+    }
+
+    ++misses_;
+    return ::operator new(size);
+}
+
+void BufferPool::deallocate(void* p, size_t size)
+{
+    if (size <= kMaxBlockSize && size >= kMinBlockSize)
+    {
+        int idx = sizeClassOf(size);
+        // 缓存未超过上限，挂回空闲链表
+        if ((freeCounts_[idx] + 1) * size <= maxCachedBytes_)
+        {
+            FreeNode* node = static_cast<FreeNode*>(p);
+            node->next = freeLists_[idx];
+            freeLists_[idx] = node;
+            ++freeCounts_[idx];
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+size_t BufferPool::cachedBytes() const
+{
+    size_t bytes = 0;
+    for (int i = 0; i < kNumSizeClasses; ++i)
+    {
+        bytes += freeCounts_[i] * (kMinBlockSize << i);
+    }
+    return bytes;
+}
+
+BufferPool* BufferPool::current()
+{
+    return t_bufferPoolInThisThread;
+}
+
+void* BufferPool::alloc(size_t size, size_t* actualSize)
+{
+    BufferPool* pool = t_bufferPoolInThisThread;
+    if (pool)
+    {
+        return pool->allocate(size, actualSize);
+    }
+
+    // 不在 loop 线程中，按同样的取整规则直接分配，保证之后可以被任何 pool 回收
+    *actualSize = roundUp(size);
+    return ::operator new(*actualSize);
+}
+
+void BufferPool::release(void* p, size_t size)
+{
+    BufferPool* pool = t_bufferPoolInThisThread;
+    if (pool)
+    {
+        pool->deallocate(p, size);
+    }
+    else
+    {
+        ::operator delete(p);
+    }
+}
+
+char* BufferPool::spillBuffer()
+{
+    if (spillBuffer_ == nullptr)
+    {
+        spillBuffer_ = new char[kSpillBufferSize];
+    }
+    return spillBuffer_;
+}